@@ -0,0 +1,109 @@
+/**
+ * Range downloads over 1, 2 and 3 links at increasing network RTT.
+ *
+ * Fetches a 64KB file from SimRadio with LiteESP8266RangeDownload and reports
+ * the simulated time, throughput, how busy the UART's receive side was, and
+ * whether the data arrived intact and in order.  A single link waits one RTT
+ * per range; more links should hide that, until the UART is the limit.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266Download.cpp \
+ *     extras/bench/download_bench.cpp -o download_bench
+ * ./download_bench [baud]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Download.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+const char path[] PROGMEM = "/test/get_bytes.php?bytes=65536";
+
+#define FILE_BYTES 65536UL
+#define RANGE_BYTES 4096
+#define BUFFER_BYTES 256
+
+static const unsigned long rtts_ms[] = { 20, 100, 300 };
+
+// Checks the data is the server's digit pattern, in order.
+struct Check {
+  unsigned long offset;
+  bool intact;
+};
+
+static bool check_sink(const char *data, const unsigned int length,
+        void *context) {
+  Check *check = (Check *)context;
+  for (unsigned int i = 0; i < length; i++) {
+    if (data[i] != (char)('0' + ((check->offset + i) % 10))) {
+      check->intact = false;
+    }
+  }
+  check->offset += length;
+  return true;
+}
+
+static void run(unsigned long baud, unsigned long rtt_ms, uint8_t links) {
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.baud = baud;
+  config.rtt_ms = rtt_ms;
+  sim.configure(config);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password) ||
+          !radio.set_multiple_connections(links > 1)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  char buffer[BUFFER_BYTES];
+  Check check = { 0, true };
+  LiteESP8266RangeDownload download;
+
+  sim.reset_stats();
+  uint64_t start_us = host_clock_us();
+  uint8_t result = download.download(&radio, host, 80, path, links,
+          RANGE_BYTES, buffer, sizeof(buffer), check_sink, &check);
+  uint64_t wall_us = host_clock_us() - start_us;
+  const SimRadioStats &stats = sim.stats();
+
+  // Receive side busy time: 10 bit times per byte.
+  double rx_busy_us = stats.bytes_to_mcu * 10.0 * 1000000.0 / baud;
+  bool ok = result == LITE_ESP8266_SUCCESS && check.intact &&
+      check.offset == FILE_BYTES;
+  printf("%6lu %5d %10.1f %10.0f %8.1f%% %8llu %6s\n", rtt_ms, links,
+         wall_us / 1000.0, check.offset * 8 / (wall_us / 1000000.0),
+         100.0 * rx_busy_us / wall_us, stats.rx_overflows +
+         stats.rx_lost_during_tx, ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 115200;
+  if (argc > 1) {
+    baud = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 range download benchmark, %lu bytes in %d byte ranges, "
+         "%d byte buffer, %lu baud\n\n", FILE_BYTES, RANGE_BYTES,
+         BUFFER_BYTES, baud);
+  printf("%6s %5s %10s %10s %9s %8s %6s\n", "rtt", "links", "wall ms",
+         "bit/s", "uart rx", "lost", "result");
+
+  for (size_t r = 0; r < sizeof(rtts_ms) / sizeof(rtts_ms[0]); r++) {
+    for (uint8_t links = 1; links <= 3; links++) {
+      run(baud, rtts_ms[r], links);
+    }
+  }
+  return 0;
+}
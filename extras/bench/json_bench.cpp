@@ -0,0 +1,219 @@
+/**
+ * A JSON status POST, built with snprintf into a buffer and with
+ * LiteESP8266JsonWriter.
+ *
+ * The same document - a few fields and an array of readings - is sent both
+ * ways, at 4, 12 and 24 readings (about 250 to 900 bytes).  The server checks
+ * the body it gets against the reference.  Reports the document size, the
+ * SRAM each method needs to hold it on an AVR, and the simulated time.  The
+ * snprintf way sends the headers, then the buffer; the writer measures the
+ * document for the Content-Length, then writes the headers and the document
+ * into one CIPSEND.  Its cost is running the builder twice, which is CPU, not
+ * wire.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266Json.cpp \
+ *     extras/bench/json_bench.cpp -o json_bench
+ * ./json_bench
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Json.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+
+const char post_request[] PROGMEM =
+    "POST /status HTTP/1.0\r\nContent-Type: application/json\r\n";
+
+const char key_node[] PROGMEM = "node";
+const char key_uptime[] PROGMEM = "uptime_s";
+const char key_battery[] PROGMEM = "battery_mv";
+const char key_door_open[] PROGMEM = "door_open";
+const char key_note[] PROGMEM = "note";
+const char key_readings[] PROGMEM = "readings";
+const char key_time[] PROGMEM = "t";
+const char key_celsius[] PROGMEM = "c";
+const char key_humidity[] PROGMEM = "rh";
+
+#define MAX_READINGS 24
+
+// On an AVR: the pointer is 2 bytes, the ints 2 each, the flags 1 each.
+#define AVR_WRITER_BYTES 8
+
+static const uint8_t reading_counts[] = { 4, 12, 24 };
+
+struct Status {
+  const char *node;
+  unsigned long uptime_s;
+  int battery_mv;
+  bool door_open;
+  const char *note;
+  uint8_t count;
+  unsigned long times[MAX_READINGS];
+  float celsius[MAX_READINGS];
+  int humidity[MAX_READINGS];
+};
+
+static void fill_status(Status *status, uint8_t count) {
+  status->node = "ferret-07";
+  status->uptime_s = 1234567;
+  status->battery_mv = 3712;
+  status->door_open = true;
+  // Needs escaping.
+  status->note = "door \"B\"\topen";
+  status->count = count;
+  for (uint8_t i = 0; i < count; i++) {
+    status->times[i] = 1700000000UL + i * 300UL;
+    status->celsius[i] = -4.13f + i * 1.37f;
+    status->humidity[i] = 40 + (i * 7) % 50;
+  }
+}
+
+// The buffer way.  The escaped note is written out by hand, as it would be.
+static unsigned int build_with_snprintf(const Status *status, char *buffer,
+        size_t size) {
+  size_t length = snprintf(buffer, size,
+      "{\"node\":\"%s\",\"uptime_s\":%lu,\"battery_mv\":%d,"
+      "\"door_open\":%s,\"note\":\"door \\\"B\\\"\\topen\",\"readings\":[",
+      status->node, status->uptime_s, status->battery_mv,
+      status->door_open ? "true" : "false");
+  for (uint8_t i = 0; i < status->count; i++) {
+    length += snprintf(buffer + length, size - length,
+        "%s{\"t\":%lu,\"c\":%.1f,\"rh\":%d}", i ? "," : "", status->times[i],
+        status->celsius[i], status->humidity[i]);
+  }
+  length += snprintf(buffer + length, size - length, "]}");
+  return length;
+}
+
+static void build_status(LiteESP8266JsonWriter *json, void *context) {
+  const Status *status = (const Status *)context;
+
+  json->begin_object();
+  json->key(key_node);
+  json->string(status->node);
+  json->key(key_uptime);
+  json->number_unsigned(status->uptime_s);
+  json->key(key_battery);
+  json->number(status->battery_mv);
+  json->key(key_door_open);
+  json->boolean_value(status->door_open);
+  json->key(key_note);
+  json->string(status->note);
+  json->key(key_readings);
+  json->begin_array();
+  for (uint8_t i = 0; i < status->count; i++) {
+    json->begin_object();
+    json->key(key_time);
+    json->number_unsigned(status->times[i]);
+    json->key(key_celsius);
+    json->number_float(status->celsius[i], 1);
+    json->key(key_humidity);
+    json->number(status->humidity[i]);
+    json->end_object();
+  }
+  json->end_array();
+  json->end_object();
+}
+
+// The server compares the body to the reference.
+struct Server {
+  std::string expected;
+  bool matched;
+};
+
+static std::string check_handler(const std::string &request, void *context) {
+  Server *server = (Server *)context;
+  size_t body = request.find("\r\n\r\n");
+  server->matched = body != std::string::npos &&
+      request.substr(body + 4) == server->expected;
+  return "HTTP/1.0 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\n"
+      "ok";
+}
+
+static void run(uint8_t count, bool use_writer) {
+  SimRadio sim;
+  Server server;
+  Status status;
+  char reference[2048];
+
+  fill_status(&status, count);
+  server.expected.assign(reference,
+      build_with_snprintf(&status, reference, sizeof(reference)));
+  server.matched = false;
+  sim.set_http_handler(check_handler, &server);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  uint64_t start_us = host_clock_us();
+  LiteESP8266JsonWriter json;
+  // What the sketch has to have in SRAM to hold the document.
+  unsigned int ram, length;
+  char buffer[2048];
+
+  if (use_writer) {
+    length = json.measure(build_status, &status);
+    ram = AVR_WRITER_BYTES;
+  } else {
+    length = build_with_snprintf(&status, buffer, sizeof(buffer));
+    ram = length + 1;
+  }
+
+  // The request line, "Content-Length: 2048\r\n\r\n" and the null.
+  char headers[96];
+  strcpy_P(headers, post_request);
+  snprintf(headers + strlen(headers), sizeof(headers) - strlen(headers),
+           "Content-Length: %u\r\n\r\n", length);
+
+  bool ok = radio.connect_progmem(host, 80);
+  if (ok && use_writer) {
+    ok = radio.begin_send(strlen(headers) + length);
+    if (ok) {
+      for (char *c = headers; *c; c++) {
+        radio.write(*c);
+      }
+      ok = json.write(&radio, build_status, &status, length);
+      ok = radio.end_send() && ok;
+    }
+  } else if (ok) {
+    ok = radio.send(headers) && radio.send(buffer);
+  }
+  char *response = ok ? radio.get_http_response(16) : NULL;
+  ok = response && server.matched;
+  free(response);
+  radio.close();
+
+  printf("%8d %-10s %6u %8u %10.1f %6s\n", count,
+         use_writer ? "writer" : "snprintf", length, ram,
+         (host_clock_us() - start_us) / 1000.0, ok ? "ok" : "FAIL");
+}
+
+int main() {
+  printf("LiteESP8266 JSON benchmark, status POST, 9600 baud\n\n");
+  printf("%8s %-10s %6s %8s %10s %6s\n", "readings", "method", "bytes",
+         "ram", "wall ms", "result");
+
+  for (size_t i = 0; i < sizeof(reading_counts) / sizeof(reading_counts[0]);
+       i++) {
+    run(reading_counts[i], false);
+    run(reading_counts[i], true);
+  }
+  return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * A CSV schedule, read whole with get_http_response() and a line at a time
+ * with LiteESP8266LineReader.
+ *
+ * The server sends a schedule of 20, 60 and 200 entries ("06:15,relay2,on"),
+ * about 0.5KB to 3.5KB, with a comment line too long for the line buffer.  The
+ * node parses every entry and checks them against what the server sent.
+ *
+ * - buffered: get_http_response() with room for the whole body, split with
+ *   strtok() - the usual way.
+ * - lines: LiteESP8266LineReader with a 40 byte buffer.
+ * - lines, closed: the same, with no Content-Length - the body ends when the
+ *   server closes the connection.
+ *
+ * Reports the SRAM each needs for the body on an AVR, entries parsed, lines
+ * truncated, and the simulated time.  A body bigger than one packet reaches
+ * get_http_response() with the next "+IPD" header in the middle of it, so
+ * the buffered way only manages schedules that fit in one packet.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266LineReader.cpp \
+ *     extras/bench/line_bench.cpp -o line_bench
+ * ./line_bench [baud]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266LineReader.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+
+const char schedule_request[] PROGMEM =
+    "GET /schedule.csv HTTP/1.0\r\n\r\n";
+const char schedule_closed_request[] PROGMEM =
+    "GET /schedule.csv?closed HTTP/1.0\r\n\r\n";
+
+#define LINE_BYTES 40
+
+static const unsigned int entry_counts[] = { 20, 60, 200 };
+
+enum Method { BUFFERED, LINES, LINES_CLOSED };
+
+// The checks: entries seen, and a sum over their fields.
+struct Tally {
+  unsigned int entries;
+  unsigned long sum;
+};
+
+static std::string entry(unsigned int i) {
+  char line[32];
+  snprintf(line, sizeof(line), "%02u:%02u,relay%u,%s\r\n", (i * 7 / 60) % 24,
+           (i * 7) % 60, i % 4, i % 3 ? "on" : "off");
+  return line;
+}
+
+static std::string schedule(unsigned int count) {
+  std::string body = "# time,relay,state - generated for node ferret-07, "
+      "do not edit by hand\r\n";
+  for (unsigned int i = 0; i < count; i++) {
+    body += entry(i);
+  }
+  return body;
+}
+
+static std::string handler(const std::string &request, void *context) {
+  std::string body = schedule(*(unsigned int *)context);
+
+  if (request.find("?closed") != std::string::npos) {
+    return "HTTP/1.0 200 OK\r\nContent-Type: text/csv\r\n\r\n" + body;
+  }
+  char headers[96];
+  snprintf(headers, sizeof(headers),
+           "HTTP/1.0 200 OK\r\nContent-Length: %zu\r\n"
+           "Content-Type: text/csv\r\n\r\n", body.size());
+  return headers + body;
+}
+
+// "06:15,relay2,on" - anything else is skipped.
+static void parse_entry(const char *line, Tally *tally) {
+  unsigned int hour, minute, relay;
+  char state[4];
+
+  if (sscanf(line, "%u:%u,relay%u,%3s", &hour, &minute, &relay, state) == 4) {
+    tally->entries++;
+    tally->sum += hour * 60 + minute + relay * 1000 +
+        (state[1] == 'n' ? 10000 : 0);
+  }
+}
+
+static void run(unsigned long baud, unsigned int count, Method method) {
+  static const char *const names[] = { "buffered", "lines", "lines, closed" };
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.baud = baud;
+  sim.configure(config);
+  sim.set_http_handler(handler, &count);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  Tally expected = { 0, 0 }, tally = { 0, 0 };
+  std::string body = schedule(count);
+  char *copy = strdup(body.c_str());
+  for (char *line = strtok(copy, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+    parse_entry(line, &expected);
+  }
+  free(copy);
+
+  uint64_t start_us = host_clock_us();
+  unsigned int ram = 0, truncated = 0;
+  bool ok = radio.connect_progmem(host, 80) && radio.send_progmem(
+      method == LINES_CLOSED ? schedule_closed_request : schedule_request);
+
+  if (ok && method == BUFFERED) {
+    char *response = radio.get_http_response(body.size() + 1);
+    for (char *line = response ? strtok(response, "\r\n") : NULL; line;
+         line = strtok(NULL, "\r\n")) {
+      parse_entry(line, &tally);
+    }
+    free(response);
+    ram = body.size() + 1;
+  } else if (ok) {
+    char line[LINE_BYTES];
+    LiteESP8266LineReader lines(&radio, line, sizeof(line));
+    ok = lines.read_headers() == 200;
+    while (ok && lines.next_line()) {
+      parse_entry(lines.line(), &tally);
+    }
+    ok = ok && !lines.timed_out();
+    truncated = lines.truncated_lines();
+    ram = LINE_BYTES;
+  }
+  radio.close();
+
+  ok = ok && tally.entries == expected.entries && tally.sum == expected.sum;
+  printf("%7u %6zu %-14s %6u %8u %9u %10.1f %6s\n", count, body.size(),
+         names[method], ram, tally.entries, truncated,
+         (host_clock_us() - start_us) / 1000.0, ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  if (argc > 1) {
+    baud = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 line reader benchmark, CSV schedule, %lu baud\n\n",
+         baud);
+  printf("%7s %6s %-14s %6s %8s %9s %10s %6s\n", "entries", "bytes", "method",
+         "ram", "parsed", "truncated", "wall ms", "result");
+  for (size_t i = 0; i < sizeof(entry_counts) / sizeof(entry_counts[0]);
+       i++) {
+    run(baud, entry_counts[i], BUFFERED);
+    run(baud, entry_counts[i], LINES);
+    run(baud, entry_counts[i], LINES_CLOSED);
+  }
+  return 0;
+}
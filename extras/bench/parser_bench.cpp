@@ -0,0 +1,283 @@
+/**
+ * Host microbenchmark for the LiteESP8266 parsing hot paths.
+ *
+ * Drives read_for_response(), read_for_responses(), copy_serial_to_buffer()
+ * and the +IPD receive loops from in-memory streams, and reports the cost per
+ * byte consumed: wall time (ns/byte) and, where the kernel allows it, retired
+ * instructions (instr/byte).  Instruction counts are the stable number to
+ * compare across parser changes; host nanoseconds only show the trend, as the
+ * AVR target is a very different machine.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     src/LiteESP8266Client.cpp src/LiteESP8266Energy.cpp \
+ *     extras/bench/parser_bench.cpp -o parser_bench
+ * ./parser_bench [iterations]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Commands.h>
+
+#include <stdio.h>
+#include <chrono>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_ITERATIONS 20000
+
+/**
+ * A Stream over a fixed block of memory.  Writes are discarded; reads walk the
+ * block and can be rewound for the next iteration.
+ */
+class MemoryStream : public Stream {
+public:
+  MemoryStream() : data_(NULL), length_(0), position_(0) {}
+
+  void load(const char *data, size_t length) {
+    data_ = data;
+    length_ = length;
+    position_ = 0;
+  }
+  void rewind() { position_ = 0; }
+  size_t consumed() const { return position_; }
+
+  int available() { return length_ - position_; }
+  int read() {
+    return (position_ < length_) ? (uint8_t)data_[position_++] : -1;
+  }
+  int peek() {
+    return (position_ < length_) ? (uint8_t)data_[position_] : -1;
+  }
+  size_t write(uint8_t c) {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+
+private:
+  const char *data_;
+  size_t length_;
+  size_t position_;
+};
+
+/**
+ * Exposes the protected parsing helpers to the benchmark, and attaches the
+ * radio to a stream without the begin() handshake.
+ */
+class BenchRadio : public LiteESP8266 {
+public:
+  void attach(Stream *stream) { radio_serial_ = stream; }
+
+  using LiteESP8266::read_for_response;
+  using LiteESP8266::read_for_responses;
+  using LiteESP8266::copy_serial_to_buffer;
+};
+
+/**
+ * Counts retired user-space instructions on the calling thread.  Falls back to
+ * reporting nothing if perf events are not available (containers, non-Linux).
+ */
+class InstructionCounter {
+public:
+  InstructionCounter() : fd_(-1) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+  ~InstructionCounter() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif
+  }
+
+  bool valid() const { return fd_ >= 0; }
+
+  void start() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  uint64_t stop() {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int fd_;
+};
+
+static BenchRadio radio;
+static MemoryStream stream;
+static InstructionCounter counter;
+
+// One benchmark case: a named input and the parser call that consumes it.
+typedef void (*bench_function)();
+
+static void run_case(const char *name, const char *input, size_t length,
+        bench_function function, unsigned long iterations) {
+  uint64_t bytes = 0;
+
+  stream.load(input, length);
+
+  // Warm up caches and branch predictors.
+  for (unsigned long i = 0; i < iterations / 10 + 1; i++) {
+    stream.rewind();
+    function();
+  }
+
+  counter.start();
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) {
+    stream.rewind();
+    function();
+    bytes += stream.consumed();
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  uint64_t instructions = counter.stop();
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+  if (counter.valid()) {
+    printf("%-28s %6zu B  %8.2f ns/byte  %8.2f instr/byte\n", name,
+           stream.consumed(), ns / bytes, (double)instructions / bytes);
+  } else {
+    printf("%-28s %6zu B  %8.2f ns/byte  %8s instr/byte\n", name,
+           stream.consumed(), ns / bytes, "n/a");
+  }
+}
+
+// =============================================================================
+// Inputs, shaped like what the radio actually sends.
+// =============================================================================
+
+static const char ok_input[] = "\r\nOK\r\n";
+static const char send_ok_input[] =
+    "\r\nRecv 64 bytes\r\n\r\nSEND OK\r\n";
+static const char connect_input[] = "CONNECT\r\n\r\nOK\r\n";
+static const char dns_input[] = "216.58.216.142\r\n";
+static const char http_header_input[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Sat, 24 Dec 2016 20:33:00 GMT\r\n"
+    "Server: Apache/2.4.10 (Raspbian)\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "Content-Length: 500\r\n"
+    "Connection: close\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n\r\n";
+
+static char ipd_input[16 + 1460];
+static size_t ipd_length;
+static char http_input[sizeof(http_header_input) + 16 + 500];
+static size_t http_length;
+
+static void build_inputs() {
+  // +IPD,1460:<full TCP segment>
+  ipd_length = sprintf(ipd_input, "+IPD,1460:");
+  for (int i = 0; i < 1460; i++) {
+    ipd_input[ipd_length++] = '0' + (i % 10);
+  }
+
+  // +IPD,<len>:<headers><500 byte body>
+  size_t header_length = strlen(http_header_input);
+  http_length = sprintf(http_input, "+IPD,%zu:%s", header_length + 500,
+          http_header_input);
+  for (int i = 0; i < 500; i++) {
+    http_input[http_length++] = '0' + (i % 10);
+  }
+}
+
+// =============================================================================
+// Cases.
+// =============================================================================
+
+static void bench_ok() {
+  radio.read_for_response(ESP8266_RESPONSE_OK);
+}
+
+static void bench_send_ok() {
+  radio.read_for_response(ESP8266_SEND_OK);
+}
+
+static void bench_ok_or_error() {
+  radio.read_for_responses(ESP8266_RESPONSE_OK, ESP8266_RESPONSE_ERROR);
+}
+
+static void bench_copy_to_buffer() {
+  char ip_address[IP_ADDRESS_LENGTH];
+  radio.copy_serial_to_buffer(ip_address, '\r', IP_ADDRESS_LENGTH);
+}
+
+static void bench_crlfcrlf() {
+  radio.read_for_response(ESP8266_CRLFCRLF);
+}
+
+static void bench_ipd_packet() {
+  char *data = radio.get_response_packet(1500);
+  free(data);
+}
+
+static void bench_http_response() {
+  char *data = radio.get_http_response(512);
+  free(data);
+}
+
+int main(int argc, char **argv) {
+  unsigned long iterations = DEFAULT_ITERATIONS;
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+  }
+
+  build_inputs();
+  radio.attach(&stream);
+
+  printf("LiteESP8266 parser benchmark, %lu iterations per case\n",
+         iterations);
+  if (!counter.valid()) {
+    printf("(perf events unavailable - instruction counts not reported)\n");
+  }
+
+  run_case("read_for_response OK", ok_input, strlen(ok_input), bench_ok,
+           iterations);
+  run_case("read_for_response SEND OK", send_ok_input, strlen(send_ok_input),
+           bench_send_ok, iterations);
+  run_case("read_for_responses OK/ERR", connect_input, strlen(connect_input),
+           bench_ok_or_error, iterations);
+  run_case("copy_serial_to_buffer IP", dns_input, strlen(dns_input),
+           bench_copy_to_buffer, iterations);
+  run_case("read_for_response CRLFCRLF", http_header_input,
+           strlen(http_header_input), bench_crlfcrlf, iterations);
+  run_case("get_response_packet 1460", ipd_input, ipd_length,
+           bench_ipd_packet, iterations / 10 + 1);
+  run_case("get_http_response 500", http_input, http_length,
+           bench_http_response, iterations / 10 + 1);
+  return 0;
+}
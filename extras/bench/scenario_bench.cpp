@@ -0,0 +1,235 @@
+/**
+ * End-to-end scenario benchmarks over a simulated radio link.
+ *
+ * Runs the scenarios from examples/TestCode, plus an enable pin power cycle,
+ * against SimRadio at 4800, 9600 and 19200 baud and reports, per scenario:
+ * simulated wall time, radio-on time, time with a connection open, bytes each
+ * way, any receive overflows, and the charge estimated by an attached
+ * LiteESP8266EnergyMeter with its default currents.  All time is virtual, so
+ * the numbers are exactly reproducible and can be tracked commit to commit.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp extras/bench/scenario_bench.cpp -o scenario_bench
+ * ./scenario_bench [rtt_ms] [capture.csv]
+ *
+ * With a capture file, every byte on the simulated wire during the 9600 baud
+ * run is written to it in the format read by extras/wire_analyzer.
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Energy.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+// Same strings as TestCode.ino.
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char google_domain[] PROGMEM = "www.google.com";
+const char nonsense_domain[] PROGMEM = "asdfqwejklwd.jihiugwebjk";
+const char host[] PROGMEM = "192.168.0.118";
+
+const char http_get_10_bytes_request[] PROGMEM =
+    "GET /test/get_bytes.php?bytes=10 HTTP/1.0\r\n";
+const char http_get_100_bytes_request[] PROGMEM =
+    "GET /test/get_bytes.php?bytes=100 HTTP/1.0\r\n";
+const char http_get_500_bytes_request[] PROGMEM =
+    "GET /test/get_bytes.php?bytes=500 HTTP/1.0\r\n";
+const char http_get_index[] PROGMEM = "GET / HTTP/1.0\r\n";
+const char http_useragent[] PROGMEM = "User-Agent: SyonykArduino/0.1\r\n";
+const char http_close_connection[] PROGMEM = "Connection: close\r\n\r\n";
+
+static const unsigned long baud_rates[] = { 4800, 9600, 19200 };
+
+// The radio's CH_PD/EN line.
+#define ENABLE_PIN 4
+
+// Each scenario returns the number of payload bytes it got back, or -1.
+typedef long (*scenario_function)(LiteESP8266 &radio, SimRadio &sim);
+
+static long scenario_begin(LiteESP8266 &radio, SimRadio &sim) {
+  esp8266_version_data version;
+  if (!radio.begin(&sim) || !radio.get_software_version(&version)) {
+    return -1;
+  }
+  return 0;
+}
+
+// Power the radio off with the enable pin and back on, to ready.
+static long scenario_power_cycle(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  radio.power_off_radio();
+  if (!radio.power_on_radio()) {
+    return -1;
+  }
+  return 0;
+}
+
+static long scenario_join(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  if (!radio.set_station_mode() || !radio.connect_to_ap(ssid, password)) {
+    return -1;
+  }
+  return 0;
+}
+
+static long scenario_dns(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  char ip_address[IP_ADDRESS_LENGTH];
+  if (!radio.dns_lookup_progmem(google_domain, ip_address)) {
+    return -1;
+  }
+  // This one should fail.
+  if (radio.dns_lookup_progmem(nonsense_domain, ip_address)) {
+    return -1;
+  }
+  return 0;
+}
+
+static long http_get(LiteESP8266 &radio, const char *progmem_request,
+        unsigned int max_allocate_bytes) {
+  if (!radio.connect_progmem(host, 80)) {
+    return -1;
+  }
+  radio.send_progmem(progmem_request);
+  radio.send_progmem(http_useragent);
+  radio.send_progmem(http_close_connection);
+
+  char *data = radio.get_http_response(max_allocate_bytes);
+  if (!data) {
+    return -1;
+  }
+  long length = strlen(data);
+  free(data);
+  radio.close();
+  return length;
+}
+
+static long scenario_get_10(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  return http_get(radio, http_get_10_bytes_request, 100);
+}
+
+static long scenario_get_100(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  return http_get(radio, http_get_100_bytes_request, 128);
+}
+
+static long scenario_get_500(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  return http_get(radio, http_get_500_bytes_request, 512);
+}
+
+static long scenario_truncated(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  return http_get(radio, http_get_100_bytes_request, 10);
+}
+
+// No Content-Length: read packets until one doesn't show up.
+static long scenario_multi_packet(LiteESP8266 &radio, SimRadio &sim) {
+  (void)sim;
+  long total = 0;
+  char *data;
+
+  if (!radio.connect_progmem(google_domain, 80)) {
+    return -1;
+  }
+  radio.send_progmem(http_get_index);
+  radio.send_progmem(http_useragent);
+  radio.send_progmem(http_close_connection);
+
+  while ((data = radio.get_response_packet(1500))) {
+    total += strlen(data);
+    free(data);
+  }
+  return total;
+}
+
+struct Scenario {
+  const char *name;
+  scenario_function function;
+};
+
+static const Scenario scenarios[] = {
+  { "begin + version", scenario_begin },
+  { "power cycle to ready", scenario_power_cycle },
+  { "join AP", scenario_join },
+  { "DNS good + bad", scenario_dns },
+  { "GET 10 bytes", scenario_get_10 },
+  { "GET 100 bytes", scenario_get_100 },
+  { "GET 500 bytes", scenario_get_500 },
+  { "GET 100 truncated to 10", scenario_truncated },
+  { "GET multi-packet", scenario_multi_packet },
+};
+
+int main(int argc, char **argv) {
+  unsigned long rtt_ms = 50;
+  FILE *capture = NULL;
+  if (argc > 1) {
+    rtt_ms = strtoul(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    capture = fopen(argv[2], "w");
+    if (!capture) {
+      perror(argv[2]);
+      return 1;
+    }
+  }
+
+  printf("LiteESP8266 scenario benchmark, network RTT %lu ms\n\n", rtt_ms);
+  printf("%-24s %6s %10s %10s %10s %7s %7s %5s %9s %8s\n", "scenario",
+         "baud", "wall ms", "radio ms", "link ms", "tx B", "rx B", "lost",
+         "est. mC", "result");
+
+  for (size_t b = 0; b < sizeof(baud_rates) / sizeof(baud_rates[0]); b++) {
+    SimRadio sim;
+    SimRadioConfig config = sim.config();
+    config.baud = baud_rates[b];
+    config.rtt_ms = rtt_ms;
+    sim.configure(config);
+    if (baud_rates[b] == 9600) {
+      sim.set_capture(capture);
+    }
+
+    LiteESP8266 radio;
+    LiteESP8266EnergyMeter meter;
+    radio.set_energy_meter(&meter);
+    radio.set_enable_pin(ENABLE_PIN);
+    sim.set_enable_pin(ENABLE_PIN);
+
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+      sim.reset_stats();
+      meter.start_cycle();
+      uint64_t start_us = host_clock_us();
+
+      long result = scenarios[s].function(radio, sim);
+
+      uint64_t wall_us = host_clock_us() - start_us;
+      const SimRadioStats &stats = sim.stats();
+      char result_text[32];
+      if (result < 0) {
+        snprintf(result_text, sizeof(result_text), "FAIL");
+      } else {
+        snprintf(result_text, sizeof(result_text), "%ld B", result);
+      }
+
+      printf("%-24s %6lu %10.1f %10.1f %10.1f %7llu %7llu %5llu %9.3f %8s\n",
+             scenarios[s].name, baud_rates[b], wall_us / 1000.0,
+             stats.radio_on_us / 1000.0, stats.link_open_us / 1000.0,
+             stats.bytes_from_mcu, stats.bytes_to_mcu,
+             stats.rx_overflows + stats.rx_lost_during_tx,
+             meter.charge_uc() / 1000.0, result_text);
+    }
+    printf("\n");
+  }
+
+  if (capture) {
+    fclose(capture);
+  }
+  return 0;
+}
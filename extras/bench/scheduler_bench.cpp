@@ -0,0 +1,292 @@
+/**
+ * Alarm latency behind a bulk upload, with and without the scheduler.
+ *
+ * A 30KB log upload (one POST, sent in 512 byte segments) starts, and an
+ * alarm (a short GET) is raised partway through.  Reports the time from
+ * raising the alarm to its response, and the time to finish the upload, for:
+ *
+ * - sequential: plain blocking calls - the alarm waits for the upload.
+ * - 1 link: LiteESP8266Scheduler with a single link.  The alarm suspends the
+ *   upload, which closes and starts over afterwards.
+ * - 2 links: multiple connections.  The alarm runs on its own link while the
+ *   upload's connection waits.  Responses are read in passive receive mode,
+ *   so each transaction gets only its own link's data.
+ *
+ * The alarm is raised a set time in, and again ("end") just as the upload
+ * finishes sending, with its response on the way.  Each transaction checks
+ * the response body it gets.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266Scheduler.cpp \
+ *     extras/bench/scheduler_bench.cpp -o scheduler_bench
+ * ./scheduler_bench [rtt_ms]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Scheduler.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+
+const char upload_request[] PROGMEM =
+    "POST /log HTTP/1.0\r\nContent-Length: 30720\r\n\r\n";
+const char alarm_request[] PROGMEM =
+    "GET /test/get_bytes.php?bytes=10 HTTP/1.0\r\n"
+    "Connection: close\r\n\r\n";
+
+#define UPLOAD_BYTES 30720
+#define SEGMENT_BYTES 512
+
+// Give up on a response after this long without one.
+#define RESPONSE_TIMEOUT_MS 5000
+
+// Raise the alarm this far into the upload - 0 for as it finishes sending.
+static const unsigned long raise_after_ms[] = { 1000, 8000, 0 };
+
+static const char upload_body[] = "Array\n(\n)\n";
+static const char alarm_body[] = "0123456789";
+
+static char segment[SEGMENT_BYTES + 1];
+
+// A response, read a step at a time.
+struct Reply {
+  std::string text;
+  unsigned long waiting_since;
+  bool matched;
+};
+
+struct Upload {
+  unsigned long sent;
+  unsigned long restarts;
+  Reply reply;
+};
+
+static void start_reply(Reply *reply) {
+  reply->text.clear();
+  reply->waiting_since = millis();
+  reply->matched = false;
+}
+
+/**
+ * One step of reading the response.  With a single link it's read whole, in
+ * active mode.  With several, one read_passive_data() for this link - the
+ * radio holds each link's data, so this never sees another link's.
+ */
+static uint8_t read_reply_step(LiteESP8266 *radio,
+        esp8266_transaction *transaction, Reply *reply, const char *body) {
+  if (transaction->link_id == LITE_ESP8266_NO_LINK) {
+    char *response = radio->get_http_response(32);
+    if (!response) {
+      return LITE_ESP8266_STEP_FAILED;
+    }
+    reply->matched = !strcmp(response, body);
+    free(response);
+    return LITE_ESP8266_STEP_DONE;
+  }
+
+  char buffer[64];
+  unsigned int length = radio->read_passive_data(buffer, sizeof(buffer),
+      COMMAND_RESPONSE_TIMEOUT, transaction->link_id);
+  if (length) {
+    reply->text.append(buffer, length);
+    reply->waiting_since = millis();
+  } else if (millis() - reply->waiting_since > RESPONSE_TIMEOUT_MS) {
+    return LITE_ESP8266_STEP_FAILED;
+  }
+
+  size_t end = reply->text.find("\r\n\r\n");
+  size_t content_length = reply->text.find("Content-Length: ");
+  if (end == std::string::npos || content_length == std::string::npos ||
+      reply->text.size() - (end + 4) <
+      strtoul(reply->text.c_str() + content_length + 16, NULL, 10)) {
+    return LITE_ESP8266_STEP_CONTINUE;
+  }
+  reply->matched = reply->text.substr(end + 4) == body;
+  return LITE_ESP8266_STEP_DONE;
+}
+
+static uint8_t upload_step(LiteESP8266 *radio,
+        esp8266_transaction *transaction, const uint8_t event) {
+  Upload *upload = (Upload *)transaction->context;
+
+  if (event == LITE_ESP8266_EVENT_SUSPEND) {
+    // No resume support on the server - start over.
+    radio->close(transaction->link_id);
+    transaction->step = 0;
+    upload->sent = 0;
+    upload->restarts++;
+    return LITE_ESP8266_STEP_CONTINUE;
+  }
+
+  switch (transaction->step) {
+    case 0:
+      transaction->step++;
+      return radio->connect_progmem(host, 80, LITE_ESP8266_TCP,
+              transaction->link_id) ?
+          LITE_ESP8266_STEP_CONTINUE : LITE_ESP8266_STEP_FAILED;
+    case 1:
+      transaction->step++;
+      return radio->send_progmem(upload_request, transaction->link_id) ?
+          LITE_ESP8266_STEP_CONTINUE : LITE_ESP8266_STEP_FAILED;
+    case 2:
+      // One segment per step.
+      if (!radio->send(segment, transaction->link_id)) {
+        return LITE_ESP8266_STEP_FAILED;
+      }
+      upload->sent += SEGMENT_BYTES;
+      if (upload->sent >= UPLOAD_BYTES) {
+        transaction->step++;
+        start_reply(&upload->reply);
+      }
+      return LITE_ESP8266_STEP_CONTINUE;
+    default:
+      return read_reply_step(radio, transaction, &upload->reply,
+              upload_body);
+  }
+}
+
+static uint8_t alarm_step(LiteESP8266 *radio,
+        esp8266_transaction *transaction, const uint8_t event) {
+  Reply *reply = (Reply *)transaction->context;
+
+  if (event == LITE_ESP8266_EVENT_SUSPEND) {
+    radio->close(transaction->link_id);
+    transaction->step = 0;
+    return LITE_ESP8266_STEP_CONTINUE;
+  }
+
+  switch (transaction->step++) {
+    case 0:
+      return radio->connect_progmem(host, 80, LITE_ESP8266_TCP,
+              transaction->link_id) ?
+          LITE_ESP8266_STEP_CONTINUE : LITE_ESP8266_STEP_FAILED;
+    case 1:
+      start_reply(reply);
+      return radio->send_progmem(alarm_request, transaction->link_id) ?
+          LITE_ESP8266_STEP_CONTINUE : LITE_ESP8266_STEP_FAILED;
+    default:
+      return read_reply_step(radio, transaction, reply, alarm_body);
+  }
+}
+
+// links 0 runs the two sequentially, without the scheduler.
+static void run(unsigned long rtt_ms, uint8_t links,
+        unsigned long raise_ms) {
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.rtt_ms = rtt_ms;
+  sim.configure(config);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  Upload upload;
+  upload.sent = 0;
+  upload.restarts = 0;
+  upload.reply.matched = false;
+  Reply alarm_reply;
+  alarm_reply.matched = false;
+  esp8266_transaction upload_transaction = { upload_step, &upload,
+      LITE_ESP8266_PRIORITY_BULK, 0, 0, 0, NULL };
+  esp8266_transaction alarm_transaction = { alarm_step, &alarm_reply,
+      LITE_ESP8266_PRIORITY_ALARM, 0, 0, 0, NULL };
+
+  uint64_t start_us = host_clock_us();
+  uint64_t raise_us = start_us + raise_ms * 1000ULL;
+  uint64_t alarm_done_us = 0, upload_done_us = 0;
+  bool raised = false;
+
+  if (links == 0) {
+    // Upload, blocking throughout, then the alarm that came in meanwhile.
+    LiteESP8266Scheduler scheduler;
+    scheduler.begin(&radio, 1);
+    scheduler.submit(&upload_transaction);
+    while (scheduler.run_once());
+    upload_done_us = host_clock_us();
+    if (!raise_ms) {
+      raise_us = upload_done_us;
+    }
+    scheduler.submit(&alarm_transaction);
+    while (scheduler.run_once());
+    alarm_done_us = host_clock_us();
+  } else {
+    LiteESP8266Scheduler scheduler;
+    if (!scheduler.begin(&radio, links)) {
+      printf("scheduler setup failed\n");
+      return;
+    }
+    scheduler.submit(&upload_transaction);
+    while (!scheduler.idle() || !raised) {
+      if (!raised && (raise_ms ? host_clock_us() >= raise_us :
+              upload_transaction.step == 3)) {
+        raise_us = host_clock_us();
+        scheduler.submit(&alarm_transaction);
+        raised = true;
+      }
+      scheduler.run_once();
+      if (!alarm_done_us &&
+              alarm_transaction.state == LITE_ESP8266_TRANSACTION_DONE) {
+        alarm_done_us = host_clock_us();
+      }
+      if (!upload_done_us &&
+              upload_transaction.state == LITE_ESP8266_TRANSACTION_DONE) {
+        upload_done_us = host_clock_us();
+      }
+      if (scheduler.idle() && !raised) {
+        // Upload finished first - raise it now.
+        host_set_clock_us(raise_us);
+      }
+    }
+  }
+
+  const char *mode = links == 0 ? "sequential" :
+      (links == 1 ? "1 link" : "2 links");
+  bool ok = upload_transaction.state == LITE_ESP8266_TRANSACTION_DONE &&
+      alarm_transaction.state == LITE_ESP8266_TRANSACTION_DONE &&
+      upload.reply.matched && alarm_reply.matched;
+  char raise[24];
+  snprintf(raise, sizeof(raise), raise_ms ? "%lu" : "end", raise_ms);
+  printf("%-12s %9s %12.1f %12.1f %9lu %6s\n", mode, raise,
+         alarm_done_us > raise_us ? (alarm_done_us - raise_us) / 1000.0 : 0.0,
+         (upload_done_us - start_us) / 1000.0, upload.restarts,
+         ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long rtt_ms = 50;
+  if (argc > 1) {
+    rtt_ms = strtoul(argv[1], NULL, 10);
+  }
+
+  memset(segment, 'x', SEGMENT_BYTES);
+  segment[SEGMENT_BYTES] = 0;
+
+  printf("LiteESP8266 scheduler benchmark, %d byte upload in %d byte "
+         "segments, 9600 baud, RTT %lu ms\n\n", UPLOAD_BYTES, SEGMENT_BYTES,
+         rtt_ms);
+  printf("%-12s %9s %12s %12s %9s %6s\n", "mode", "raise ms", "alarm ms",
+         "upload ms", "restarts", "result");
+
+  for (size_t r = 0; r < sizeof(raise_after_ms) / sizeof(raise_after_ms[0]);
+       r++) {
+    for (uint8_t links = 0; links <= 2; links++) {
+      run(rtt_ms, links, raise_after_ms[r]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,349 @@
+/**
+ * A soak test: two months of a sensor node's traffic, in virtual time.
+ *
+ * Some failures only show up after weeks: millis() rolls over after 49.7
+ * days, and an Uno's heap of a kilobyte or so fragments as buffers come and
+ * go.  This runs the library against SimRadio for SOAK_DAYS, one request every
+ * 5 minutes, from a mix:
+ *
+ * - post: POST a reading, read the short reply with get_http_response(),
+ *   and free it.
+ * - status: GET 20 to 200 bytes with get_http_response().  The sketch keeps
+ *   it until it fetches the next.
+ * - config: GET 300 to 450 bytes as one packet with get_response_packet(),
+ *   also kept until the next.
+ * - ip: get_local_ip(), a plain AT round trip.
+ * - listen: connect and wait for a command from the server, which doesn't
+ *   send one - the wait ends by timing out.
+ *
+ * The kept buffers outlive ones allocated after them, so the heap - the
+ * simulated AVR heap, HEAP_BYTES of it (see extras/host/sim_heap.h) - gets
+ * holes.  For the minute either side of the rollover, the requests run back
+ * to back instead, every other one a listen, so timeouts are running when it
+ * happens.
+ *
+ * A request still going after STUCK_MS trips a watchdog, as the AVR's would:
+ * the board resets, losing the heap, and the radio is reset and rejoined.
+ *
+ * Every 5 days it reports the requests, the failures (no response, or the
+ * wrong one), stuck requests (watchdog resets, or the radio not answering AT
+ * after a failure), latency percentiles of the requests that finished, failed
+ * mallocs, and the heap: the least free in one block and the worst
+ * fragmentation seen.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -DLITE_HOST_SIM_HEAP -Iextras/host -Isrc \
+ *     extras/host/host_arduino.cpp extras/host/sim_radio.cpp \
+ *     extras/host/sim_heap.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp extras/bench/soak_bench.cpp -o soak_bench
+ * ./soak_bench [days]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+
+#include "../host/sim_heap.h"
+#include "../host/sim_radio.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+
+#define SOAK_DAYS 62
+#define REPORT_DAYS 5
+#define REQUEST_EVERY_MS 300000ULL
+#define HEAP_BYTES 1024
+#define STUCK_MS 30000
+
+// millis() rolls over at 2^32 ms, and for this long either side of it the
+// requests run back to back, a second or less apart.
+#define ROLLOVER_US (4294967296ULL * 1000)
+#define ROLLOVER_BURST_US (60000ULL * 1000)
+#define BURST_GAP_MS 1000
+
+#define DAY_US (86400ULL * 1000000)
+
+enum Request { POST, STATUS, CONFIG, IP, LISTEN };
+
+// One request every 5 minutes, in this order.
+static const Request mix[] = {
+  POST, STATUS, POST, IP, POST, STATUS, POST, CONFIG, POST, STATUS, POST, LISTEN
+};
+
+/**
+ * Sits between the library and SimRadio.  Armed, it resets the board - jumps
+ * back to the soak loop - if the library is still reading after the deadline.
+ */
+class Watchdog : public Stream {
+public:
+  explicit Watchdog(SimRadio *sim) : sim_(sim), deadline_us_(0) {}
+
+  void arm(uint64_t timeout_us) { deadline_us_ = host_clock_us() + timeout_us; }
+  void disarm() { deadline_us_ = 0; }
+
+  int available() { check(); return sim_->available(); }
+  int read() { check(); return sim_->read(); }
+  int peek() { return sim_->peek(); }
+  size_t write(uint8_t c) { return sim_->write(c); }
+  using Print::write;
+
+  jmp_buf reset;
+
+private:
+  void check() {
+    if (deadline_us_ && host_clock_us() > deadline_us_) {
+      deadline_us_ = 0;
+      longjmp(reset, 1);
+    }
+  }
+
+  SimRadio *sim_;
+  uint64_t deadline_us_;
+};
+
+struct Window {
+  unsigned long requests;
+  std::vector<unsigned long> latencies_ms;
+  unsigned long failed;
+  unsigned long stuck;
+  unsigned long long heap_failures;
+  size_t least_largest_free;
+  double worst_fragmentation;
+};
+
+// The sketch's kept responses.
+static char *status = NULL;
+static char *config = NULL;
+
+static uint32_t random_state = 1;
+
+static unsigned int random_between(unsigned int low, unsigned int high) {
+  random_state = random_state * 1103515245 + 12345;
+  return low + (random_state >> 16) % (high - low + 1);
+}
+
+static bool get(LiteESP8266 &radio, unsigned int bytes, bool packet,
+                char **kept) {
+  char request[96];
+  char *response = NULL;
+
+  // Done with the old one.
+  free(*kept);
+  *kept = NULL;
+
+  snprintf(request, sizeof(request),
+           "GET /test/get_bytes.php?bytes=%u HTTP/1.1\r\n"
+           "Host: 192.168.0.118\r\n\r\n", bytes);
+  if (radio.connect_progmem(host, 80) && radio.send(request)) {
+    response = packet ? radio.get_response_packet(600) :
+        radio.get_http_response(256);
+  }
+  radio.close();
+
+  // The body ends with the digits 0 to 9, over and over.
+  *kept = response;
+  return response && strlen(response) >= bytes &&
+      response[strlen(response) - 1] == (char)('0' + (bytes - 1) % 10);
+}
+
+static bool post(LiteESP8266 &radio, unsigned long reading) {
+  char request[128], body[32];
+  bool ok = false;
+
+  snprintf(body, sizeof(body), "temp=%lu", reading);
+  snprintf(request, sizeof(request),
+           "POST /readings HTTP/1.1\r\nHost: 192.168.0.118\r\n"
+           "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+  if (radio.connect_progmem(host, 80) && radio.send(request)) {
+    char *response = radio.get_http_response(32);
+    ok = response && !strcmp(response, "Array\n(\n)\n");
+    free(response);
+  }
+  radio.close();
+  return ok;
+}
+
+// Waits for a command that never comes.
+static bool listen(LiteESP8266 &radio) {
+  char *command = NULL;
+  bool ok = radio.connect_progmem(host, 80);
+
+  if (ok) {
+    command = radio.get_response_packet(32);
+  }
+  radio.close();
+  free(command);
+  return ok && !command;
+}
+
+static bool run_request(LiteESP8266 &radio, Request request,
+                        unsigned long count) {
+  char ip[IP_ADDRESS_LENGTH];
+
+  switch (request) {
+    case POST:
+      return post(radio, count);
+    case STATUS:
+      return get(radio, random_between(20, 200), false, &status);
+    case CONFIG:
+      return get(radio, random_between(300, 450), true, &config);
+    case IP:
+      return radio.get_local_ip(ip);
+    default:
+      return listen(radio);
+  }
+}
+
+/**
+ * Run a request under the watchdog.  Returns false if it tripped; ok is
+ * whether the request worked.
+ */
+static bool guarded_request(Watchdog &watchdog, LiteESP8266 &radio,
+                            Request request, unsigned long count, bool *ok) {
+  if (setjmp(watchdog.reset)) {
+    return false;
+  }
+  watchdog.arm(STUCK_MS * 1000ULL);
+  *ok = run_request(radio, request, count);
+  watchdog.disarm();
+  return true;
+}
+
+// The sketch's setup().
+static bool start(LiteESP8266 &radio, Stream *stream) {
+  return radio.begin(stream) && radio.reset_radio() &&
+      radio.wait_for_ready() && radio.init_radio() &&
+      radio.set_station_mode() && radio.connect_to_ap(ssid, password);
+}
+
+static unsigned long percentile(const std::vector<unsigned long> &sorted,
+                                unsigned int percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[(sorted.size() - 1) * percent / 100];
+}
+
+static void report(unsigned int first_day, unsigned int last_day,
+                   Window &window) {
+  std::vector<unsigned long> &latencies = window.latencies_ms;
+  std::sort(latencies.begin(), latencies.end());
+  bool rollover = first_day * DAY_US <= ROLLOVER_US &&
+      ROLLOVER_US < last_day * DAY_US;
+
+  printf("%3u-%-3u%c %8lu %6lu %5lu %7lu %7lu %7lu %7lu %9llu %9zu %7.1f\n",
+         first_day, last_day, rollover ? '*' : ' ', window.requests,
+         window.failed, window.stuck, percentile(latencies, 50),
+         percentile(latencies, 90), percentile(latencies, 99),
+         latencies.empty() ? 0 : latencies.back(), window.heap_failures,
+         window.least_largest_free, window.worst_fragmentation);
+}
+
+int main(int argc, char **argv) {
+  unsigned int days = SOAK_DAYS;
+  if (argc > 1) {
+    days = strtoul(argv[1], NULL, 10);
+  }
+
+  sim_heap_configure(HEAP_BYTES);
+  SimRadio sim;
+  Watchdog watchdog(&sim);
+  LiteESP8266 radio;
+  if (!start(radio, &watchdog)) {
+    printf("radio setup failed\n");
+    return 1;
+  }
+
+  printf("LiteESP8266 soak, %u days, a request every %llu minutes, %d byte "
+         "heap\n", days, REQUEST_EVERY_MS / 60000, HEAP_BYTES);
+  printf("(* - millis() rolls over in these days)\n\n");
+  printf("%-8s %8s %6s %5s %7s %7s %7s %7s %9s %9s %7s\n", "days",
+         "requests", "failed", "stuck", "p50 ms", "p90 ms", "p99 ms",
+         "max ms", "heap fail", "min block", "frag %");
+
+  uint64_t end_us = days * DAY_US;
+  uint64_t next_us = 0;
+  unsigned long count = 0;
+  unsigned int window_start = 0;
+  unsigned long long heap_failures = 0;
+  Window window = Window();
+  window.least_largest_free = HEAP_BYTES;
+  unsigned long total_requests = 0, total_failed = 0, total_stuck = 0;
+
+  while (next_us < end_us) {
+    host_set_clock_us(next_us);
+    bool burst = next_us >= ROLLOVER_US - ROLLOVER_BURST_US &&
+        next_us < ROLLOVER_US + ROLLOVER_BURST_US;
+    Request request = (burst && count % 2) ? LISTEN :
+        mix[count % (sizeof(mix) / sizeof(mix[0]))];
+
+    uint64_t start_us = host_clock_us();
+    bool ok = false;
+    window.requests++;
+    if (guarded_request(watchdog, radio, request, count, &ok)) {
+      window.latencies_ms.push_back((host_clock_us() - start_us) / 1000);
+      if (!ok) {
+        window.failed++;
+        window.stuck += radio.test() ? 0 : 1;
+      }
+    } else {
+      // Reset: the heap starts over, and so does the sketch.
+      window.failed++;
+      window.stuck++;
+      window.heap_failures += sim_heap_stats().failures - heap_failures;
+      heap_failures = 0;
+      sim_heap_configure(HEAP_BYTES);
+      status = NULL;
+      config = NULL;
+      start(radio, &watchdog);
+    }
+
+    SimHeapStats heap = sim_heap_stats();
+    window.heap_failures += heap.failures - heap_failures;
+    heap_failures = heap.failures;
+    window.least_largest_free =
+        std::min(window.least_largest_free, heap.largest_free);
+    window.worst_fragmentation =
+        std::max(window.worst_fragmentation, sim_heap_fragmentation(heap));
+
+    count++;
+    uint64_t now_us = host_clock_us();
+    if (now_us >= ROLLOVER_US - ROLLOVER_BURST_US &&
+            now_us < ROLLOVER_US + ROLLOVER_BURST_US) {
+      next_us = now_us + random_between(0, BURST_GAP_MS) * 1000ULL;
+    } else {
+      next_us = std::max<uint64_t>(next_us + REQUEST_EVERY_MS * 1000, now_us);
+      if (now_us < ROLLOVER_US - ROLLOVER_BURST_US &&
+              next_us > ROLLOVER_US - ROLLOVER_BURST_US) {
+        next_us = ROLLOVER_US - ROLLOVER_BURST_US;
+      }
+    }
+
+    if (next_us >= (window_start + REPORT_DAYS) * DAY_US ||
+            next_us >= end_us) {
+      unsigned int window_end = std::min(window_start + REPORT_DAYS, days);
+      report(window_start, window_end, window);
+      total_requests += window.requests;
+      total_failed += window.failed;
+      total_stuck += window.stuck;
+      window_start = window_end;
+      window = Window();
+      window.least_largest_free = HEAP_BYTES;
+    }
+  }
+
+  SimHeapStats heap = sim_heap_stats();
+  printf("\n%lu requests, %lu failed, %lu stuck, heap high water %zu "
+         "bytes\n", total_requests, total_failed, total_stuck,
+         heap.high_water);
+  free(status);
+  free(config);
+  return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * Commands from a server: polling, and LiteESP8266EventSource.
+ *
+ * The server has 20 commands for the node over two minutes, each created at a
+ * set time.  The node gets them either:
+ *
+ * - polling: a GET every 5 seconds for the commands after the last one it
+ *   has, on a new connection each time.
+ * - sse: an event stream.  The server pushes each command as it's created,
+ *   and it arrives half a round trip later.  Halfway through, the server
+ *   closes the stream with a command on its way; the client reconnects with
+ *   Last-Event-ID and the server replays what was missed.
+ *
+ * Reports the commands delivered, missed and duplicated, the mean and worst
+ * time from creation to arrival, the AT commands sent, and the share of the
+ * time a connection was open.  At the sim's 9600 baud, about 50ms of each
+ * arrival is the event crossing the UART.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266EventSource.cpp \
+ *     extras/bench/sse_bench.cpp -o sse_bench
+ * ./sse_bench [rtt_ms]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266EventSource.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+const char events_path[] PROGMEM = "/events";
+
+#define COMMANDS 20
+#define RUN_MS 120000UL
+#define POLL_INTERVAL_MS 5000UL
+#define LOOP_MS 5
+
+// The server drops the stream here, just after pushing a command.
+#define SERVER_CLOSE_MS 60000UL
+
+// Without mux, everything is on link 0.
+#define STREAM_LINK 0
+
+struct Server {
+  SimRadio *sim;
+  unsigned long long start_us;
+  unsigned long long created_us[COMMANDS];
+  bool pushed[COMMANDS];
+  bool subscribed;
+};
+
+struct Client {
+  Server *server;
+  unsigned int received[COMMANDS];
+  unsigned long long latency_sum_us;
+  unsigned long long latency_max_us;
+};
+
+static unsigned long long now_us(const Server *server) {
+  return host_clock_us() - server->start_us;
+}
+
+// Spread out, but not evenly, with one pushed just as the server closes.
+static void create_commands(Server *server) {
+  for (int i = 0; i < COMMANDS; i++) {
+    server->created_us[i] = (2000ULL + i * 5800ULL + (i * 37 % 17) * 130ULL) *
+        1000ULL;
+    server->pushed[i] = false;
+  }
+  server->created_us[COMMANDS / 2] = SERVER_CLOSE_MS * 1000ULL;
+}
+
+static std::string event_text(int id) {
+  char text[64];
+  snprintf(text, sizeof(text), "event: relay\nid: %d\ndata: %s\n\n", id,
+           id % 2 ? "on" : "off");
+  return text;
+}
+
+static std::string handler(const std::string &request, void *context) {
+  Server *server = (Server *)context;
+  std::string body;
+  int after = -1;
+  size_t at;
+
+  if (request.compare(0, 11, "GET /events") == 0) {
+    at = request.find("Last-Event-ID: ");
+    if (at != std::string::npos) {
+      after = atoi(request.c_str() + at + 15);
+    }
+    body = "retry: 500\n\n: replaying\n\n";
+    for (int i = after + 1; i < COMMANDS; i++) {
+      if (server->created_us[i] <= now_us(server)) {
+        body += event_text(i);
+        server->pushed[i] = true;
+      }
+    }
+    server->subscribed = true;
+    return "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n\r\n" + body;
+  }
+
+  // GET /commands?after=<id>: one "<id> <relay>" line each.
+  at = request.find("after=");
+  if (at != std::string::npos) {
+    after = atoi(request.c_str() + at + 6);
+  }
+  for (int i = after + 1; i < COMMANDS; i++) {
+    if (server->created_us[i] <= now_us(server)) {
+      char line[24];
+      snprintf(line, sizeof(line), "%d %s\n", i, i % 2 ? "on" : "off");
+      body += line;
+    }
+  }
+  char headers[96];
+  snprintf(headers, sizeof(headers),
+           "HTTP/1.0 200 OK\r\nContent-Length: %zu\r\n"
+           "Connection: close\r\n\r\n", body.size());
+  return headers + body;
+}
+
+// Push anything new to the stream, if it's open.
+static void push_new(Server *server) {
+  for (int i = 0; i < COMMANDS; i++) {
+    if (!server->pushed[i] && server->created_us[i] <= now_us(server) &&
+            server->subscribed) {
+      server->sim->server_send(STREAM_LINK, event_text(i),
+          server->sim->config().rtt_ms * 500ULL);
+      server->pushed[i] = true;
+    }
+  }
+}
+
+static void arrived(Client *client, int id) {
+  unsigned long long latency_us;
+
+  if (id < 0 || id >= COMMANDS) {
+    return;
+  }
+  if (!client->received[id]++) {
+    latency_us = now_us(client->server) - client->server->created_us[id];
+    client->latency_sum_us += latency_us;
+    if (latency_us > client->latency_max_us) {
+      client->latency_max_us = latency_us;
+    }
+  }
+}
+
+// The handler is given the data; the id is the source's last_event_id().
+static LiteESP8266EventSource *bench_source;
+
+static void on_command(const char *event, const char *data, void *context) {
+  (void)event;
+  (void)data;
+  arrived((Client *)context, atoi(bench_source->last_event_id()));
+}
+
+static void poll_commands(LiteESP8266 &radio, Client *client, int *last_id) {
+  char request[64];
+  char *response, *line;
+
+  snprintf(request, sizeof(request),
+           "GET /commands?after=%d HTTP/1.0\r\n\r\n", *last_id);
+  if (!radio.connect_progmem(host, 80)) {
+    return;
+  }
+  if (radio.send(request)) {
+    response = radio.get_http_response(128);
+    for (line = response; line && *line; ) {
+      int id = atoi(line);
+      arrived(client, id);
+      if (id > *last_id) {
+        *last_id = id;
+      }
+      line = strchr(line, '\n');
+      line = line ? line + 1 : NULL;
+    }
+    free(response);
+  }
+  radio.close();
+}
+
+static void run(unsigned long rtt_ms, bool use_sse) {
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.rtt_ms = rtt_ms;
+  sim.configure(config);
+
+  Server server;
+  server.sim = &sim;
+  server.subscribed = false;
+  create_commands(&server);
+  sim.set_http_handler(handler, &server);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  Client client;
+  memset(&client, 0, sizeof(client));
+  client.server = &server;
+  sim.reset_stats();
+  server.start_us = host_clock_us();
+
+  LiteESP8266EventSource events;
+  char data[32];
+  int last_id = -1;
+  unsigned long long next_poll_us = 0;
+  bool closed = false;
+
+  bench_source = &events;
+  if (use_sse) {
+    events.begin(&radio, host, 80, events_path, data, sizeof(data),
+                 on_command, &client);
+  }
+
+  while (now_us(&server) < RUN_MS * 1000ULL) {
+    if (use_sse) {
+      push_new(&server);
+      if (!closed && now_us(&server) >= SERVER_CLOSE_MS * 1000ULL) {
+        sim.server_close(STREAM_LINK, 0);
+        server.subscribed = false;
+        closed = true;
+      }
+      events.poll();
+    } else if (now_us(&server) >= next_poll_us) {
+      next_poll_us += POLL_INTERVAL_MS * 1000ULL;
+      poll_commands(radio, &client, &last_id);
+    }
+    delay(LOOP_MS);
+  }
+  if (use_sse) {
+    events.stop();
+  }
+
+  unsigned int delivered = 0, duplicated = 0;
+  for (int i = 0; i < COMMANDS; i++) {
+    delivered += client.received[i] ? 1 : 0;
+    duplicated += client.received[i] > 1 ? client.received[i] - 1 : 0;
+  }
+  const SimRadioStats &stats = sim.stats();
+  printf("%-8s %6lu %9u %6u %6u %9.1f %9.1f %9llu %6.1f%%\n",
+         use_sse ? "sse" : "polling", rtt_ms, delivered, COMMANDS - delivered,
+         duplicated,
+         delivered ? client.latency_sum_us / 1000.0 / delivered : 0.0,
+         client.latency_max_us / 1000.0, stats.commands,
+         100.0 * stats.link_open_us / (RUN_MS * 1000.0));
+}
+
+int main(int argc, char **argv) {
+  unsigned long rtt_ms = 80;
+  if (argc > 1) {
+    rtt_ms = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 server push benchmark, %d commands over %lus\n\n",
+         COMMANDS, RUN_MS / 1000);
+  printf("%-8s %6s %9s %6s %6s %9s %9s %9s %7s\n", "method", "rtt", "delivered",
+         "missed", "dupes", "mean ms", "max ms", "commands", "open");
+  run(rtt_ms, false);
+  run(rtt_ms, true);
+  return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * Shipping log lines off the node: an HTTP POST or a UDP datagram per line,
+ * and LiteESP8266SyslogSink.
+ *
+ * For a minute, the sketch logs a status line every half second, plus a burst
+ * of 16 lines, 4 a loop, at 20s and 40s - 152 lines.  Its loop runs every
+ * 10ms:
+ *
+ * - http: a POST per line, on a new connection.
+ * - udp: a datagram per line, on a kept UDP link.
+ * - sink 192: LiteESP8266SyslogSink with a 192 byte buffer, poll()ed every
+ *   loop, sending after at most 5 seconds.  A burst can still overfill it
+ *   between polls.
+ * - sink 64: the same with a 64 byte buffer, too small for the bursts - the
+ *   lines that don't fit are dropped and counted.
+ *
+ * The server counts the lines it gets, and the drops the sink reports.
+ * Reports lines delivered and dropped, datagrams or requests, AT commands,
+ * the total time the sketch spent logging (log calls and polls), and the
+ * longest the loop was held up by one log call or poll.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266Syslog.cpp \
+ *     extras/bench/syslog_bench.cpp -o syslog_bench
+ * ./syslog_bench [baud]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Syslog.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+const char tag[] PROGMEM = "ferret-07";
+
+#define RUN_MS 60000UL
+#define LOOP_MS 10
+#define STATUS_EVERY_MS 500
+#define BURST_LINES 16
+#define BURST_PER_LOOP 4
+#define LOG_LINK 4
+
+static const unsigned long burst_at_ms[] = { 20000, 40000 };
+
+enum Method { HTTP, UDP, SINK, SINK_SMALL };
+
+// The collector's side.
+struct Collector {
+  unsigned int lines;
+  unsigned int reported_drops;
+  unsigned int messages;
+};
+
+static void count_datagram(const std::string &datagram, void *context) {
+  Collector *collector = (Collector *)context;
+  size_t start = datagram.find(": ");
+
+  collector->messages++;
+  start = (start == std::string::npos) ? 0 : start + 2;
+  while (start < datagram.size()) {
+    size_t end = datagram.find('\n', start);
+    if (end == std::string::npos) {
+      end = datagram.size();
+    }
+    std::string line = datagram.substr(start, end - start);
+    if (line[0] == '(') {
+      collector->reported_drops += atoi(line.c_str() + 1);
+    } else {
+      collector->lines++;
+    }
+    start = end + 1;
+  }
+}
+
+static std::string count_post(const std::string &request, void *context) {
+  size_t body = request.find("\r\n\r\n");
+  count_datagram(request.substr(body + 4), context);
+  return "HTTP/1.0 204 No Content\r\nContent-Length: 0\r\n"
+      "Connection: close\r\n\r\n";
+}
+
+static void post_line(LiteESP8266 &radio, const char *line) {
+  char request[160];
+
+  snprintf(request, sizeof(request),
+           "POST /log HTTP/1.0\r\nContent-Length: %zu\r\n\r\n%s",
+           strlen(line), line);
+  if (radio.connect_progmem(host, 80, LITE_ESP8266_TCP, 0) &&
+          radio.send(request, 0)) {
+    free(radio.get_http_response(16));
+  }
+  radio.close(0);
+}
+
+static void run(unsigned long baud, Method method) {
+  static const char *const names[] = { "http", "udp", "sink 192", "sink 64" };
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.baud = baud;
+  sim.configure(config);
+
+  Collector collector = { 0, 0, 0 };
+  sim.set_http_handler(count_post, &collector);
+  sim.set_datagram_handler(count_datagram, &collector);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password) ||
+          !radio.set_multiple_connections(true)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  char buffer[192];
+  LiteESP8266SyslogSink sink;
+  if (method == SINK || method == SINK_SMALL) {
+    sink.begin(&radio, host, 514, tag, buffer,
+               method == SINK ? 192 : 64, LOG_LINK);
+  }
+  if (method == UDP) {
+    radio.connect_progmem(host, 514, LITE_ESP8266_UDP, LOG_LINK);
+  }
+
+  sim.reset_stats();
+  uint64_t start_us = host_clock_us();
+  uint64_t logging_us = 0, worst_us = 0, call_us;
+  unsigned long next_status_ms = 0, logged = 0;
+  size_t next_burst = 0;
+  unsigned int burst_left = 0;
+  char line[64];
+
+  while (host_clock_us() - start_us < RUN_MS * 1000ULL) {
+    unsigned long now_ms = (host_clock_us() - start_us) / 1000;
+    unsigned int count = 0;
+
+    if (now_ms >= next_status_ms) {
+      next_status_ms += STATUS_EVERY_MS;
+      count = 1;
+    }
+    if (next_burst < sizeof(burst_at_ms) / sizeof(burst_at_ms[0]) &&
+            now_ms >= burst_at_ms[next_burst]) {
+      next_burst++;
+      burst_left = BURST_LINES;
+    }
+    if (burst_left) {
+      burst_left -= BURST_PER_LOOP;
+      count += BURST_PER_LOOP;
+    }
+
+    for (unsigned int i = 0; i < count; i++, logged++) {
+      snprintf(line, sizeof(line), "t=%lu temp=21.%lu door=%s",
+               now_ms, logged % 10, logged % 7 ? "shut" : "open");
+      call_us = host_clock_us();
+      if (method == HTTP) {
+        post_line(radio, line);
+      } else if (method == UDP) {
+        std::string datagram = std::string("<134>ferret-07: ") + line;
+        radio.send(datagram.c_str(), LOG_LINK);
+      } else {
+        sink.println(line);
+      }
+      call_us = host_clock_us() - call_us;
+      logging_us += call_us;
+      worst_us = call_us > worst_us ? call_us : worst_us;
+    }
+
+    if (method == SINK || method == SINK_SMALL) {
+      call_us = host_clock_us();
+      sink.poll();
+      call_us = host_clock_us() - call_us;
+      logging_us += call_us;
+      worst_us = call_us > worst_us ? call_us : worst_us;
+    }
+    delay(LOOP_MS);
+  }
+  if (method == SINK || method == SINK_SMALL) {
+    sink.send_now();
+  }
+
+  bool ok = collector.lines + collector.reported_drops == logged &&
+      (method < SINK || collector.reported_drops == sink.dropped_lines());
+  printf("%-9s %6lu %9u %7u %8u %9llu %10.1f %9.1f %6s\n", names[method],
+         logged, collector.lines, collector.reported_drops, collector.messages,
+         sim.stats().commands, logging_us / 1000.0, worst_us / 1000.0,
+         ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  if (argc > 1) {
+    baud = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 log shipping benchmark, %lus, %lu baud\n\n",
+         RUN_MS / 1000, baud);
+  printf("%-9s %6s %9s %7s %8s %9s %10s %9s %6s\n", "method", "logged",
+         "delivered", "dropped", "messages", "commands", "logging ms",
+         "worst ms", "result");
+  run(baud, HTTP);
+  run(baud, UDP);
+  run(baud, SINK);
+  run(baud, SINK_SMALL);
+  return 0;
+}
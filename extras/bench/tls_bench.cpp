@@ -0,0 +1,203 @@
+/**
+ * HTTPS uploads: a new SSL connection per request, and one kept open with
+ * LiteESP8266SecureLink.
+ *
+ * The sketch POSTs a 400 byte reading every 15 seconds, 12 times.  Half way
+ * through, the server closes the connection (a restart, or its keep-alive
+ * timeout), so the kept link has to notice and connect again:
+ *
+ * - tcp close: plain HTTP, a new connection per request - the baseline.
+ * - ssl close: HTTPS, a new SSL connection and handshake per request.
+ * - ssl keep: HTTPS over LiteESP8266SecureLink, with SNI, "Connection:
+ *   keep-alive".
+ * - ssl split: the same, sending the headers and the body separately.  Once,
+ *   the server hangs up between the two: that upload should fail, rather than
+ *   send the body alone on a new connection.
+ *
+ * The SSL runs set a 4096 byte SSL buffer first.  Reports the handshakes and
+ * their mean time, the mean time per upload (connecting included), AT
+ * commands, the time links were open, and the charge used by the uploads
+ * themselves, from LiteESP8266EnergyMeter.  The simulated handshake is three
+ * round trips plus the radio's crypto (SimRadioConfig::ssl_setup_ms).  A
+ * request the server gets that isn't a whole POST fails the run.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266SecureLink.cpp \
+ *     extras/bench/tls_bench.cpp -o tls_bench
+ * ./tls_bench [baud]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Energy.h>
+#include <LiteESP8266SecureLink.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "example.com";
+
+#define UPLOADS 12
+#define UPLOAD_EVERY_MS 15000UL
+#define BODY_LENGTH 400
+#define SERVER_CLOSE_AFTER 6
+#define SERVER_CLOSE_DURING 9
+
+enum Method { TCP_CLOSE, SSL_CLOSE, SSL_KEEP, SSL_SPLIT };
+
+struct Server {
+  unsigned int received;    // Whole POSTs.
+  unsigned int malformed;   // Anything else.
+};
+
+static const unsigned long rtts_ms[] = { 50, 200 };
+
+static std::string accept_post(const std::string &request, void *context) {
+  Server *server = (Server *)context;
+  size_t body = request.find("\r\n\r\n");
+
+  if (request.compare(0, 5, "POST ") == 0 &&
+      request.size() - (body + 4) == BODY_LENGTH) {
+    server->received++;
+  } else {
+    server->malformed++;
+  }
+  return std::string("HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: ") +
+      (request.find("Connection: keep-alive") == std::string::npos ?
+       "close" : "keep-alive") + "\r\n\r\nok";
+}
+
+static void run(unsigned long baud, unsigned long rtt_ms, Method method) {
+  static const char *const names[] = { "tcp close", "ssl close", "ssl keep",
+                                       "ssl split" };
+  bool keep = method == SSL_KEEP || method == SSL_SPLIT;
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.baud = baud;
+  config.rtt_ms = rtt_ms;
+  sim.configure(config);
+
+  Server server = { 0, 0 };
+  sim.set_http_handler(accept_post, &server);
+
+  LiteESP8266 radio;
+  LiteESP8266EnergyMeter meter;
+  radio.set_energy_meter(&meter);
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password) ||
+          (method != TCP_CLOSE && !radio.set_ssl_buffer_size(4096))) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  LiteESP8266SecureLink link;
+  link.begin(&radio, host, 443, LITE_ESP8266_NO_LINK, true);
+
+  std::string body(BODY_LENGTH, 'x');
+  char headers[128];
+  snprintf(headers, sizeof(headers),
+           "POST /readings HTTP/1.1\r\nHost: example.com\r\n"
+           "Content-Length: %d\r\nConnection: %s\r\n\r\n", BODY_LENGTH,
+           keep ? "keep-alive" : "close");
+  std::string request = headers + body;
+
+  sim.reset_stats();
+  meter.start_cycle();
+  uint64_t start_us = host_clock_us();
+  uint64_t upload_us = 0, handshake_us = 0, call_us;
+  unsigned long charge_uc = 0;
+  unsigned int handshakes = 0, responses = 0, failed_sends = 0;
+
+  for (unsigned int i = 0; i < UPLOADS; i++) {
+    while (host_clock_us() - start_us < i * UPLOAD_EVERY_MS * 1000ULL) {
+      delay(10);
+    }
+    if (i == SERVER_CLOSE_AFTER) {
+      // The server has hung up on the idle connection.
+      sim.server_close(0, 0);
+    }
+
+    call_us = host_clock_us();
+    meter.begin_operation();
+    bool sent;
+    if (method == SSL_KEEP) {
+      link.begin_request();
+      sent = link.send(request.c_str());
+    } else if (method == SSL_SPLIT) {
+      link.begin_request();
+      sent = link.send(headers);
+      if (sent && i == SERVER_CLOSE_DURING) {
+        sim.server_close(0, 0);
+      }
+      sent = sent && link.send(body.c_str());
+      if (!sent) {
+        failed_sends++;
+      }
+    } else {
+      uint64_t connect_us = host_clock_us();
+      sent = radio.connect_progmem(host, method == SSL_CLOSE ? 443 : 80,
+              method == SSL_CLOSE ? LITE_ESP8266_SSL : LITE_ESP8266_TCP);
+      if (sent && method == SSL_CLOSE) {
+        handshakes++;
+        handshake_us += host_clock_us() - connect_us;
+      }
+      sent = sent && radio.send(request.c_str());
+    }
+    char *response = sent ? radio.get_http_response(16) : NULL;
+    if (response && !strcmp(response, "ok")) {
+      responses++;
+    }
+    free(response);
+    if (!keep) {
+      radio.close();
+    }
+    charge_uc += meter.operation_charge_uc();
+    upload_us += host_clock_us() - call_us;
+  }
+  if (keep) {
+    handshakes = link.handshakes();
+    handshake_us = link.handshake_ms() * 1000ULL;
+    link.close();
+  }
+
+  const SimRadioStats &stats = sim.stats();
+  // The split run loses the upload the server hung up during.
+  unsigned int lost = method == SSL_SPLIT ? 1 : 0;
+  bool ok = responses == UPLOADS - lost && server.received == UPLOADS - lost &&
+      server.malformed == 0 && failed_sends == lost;
+  printf("%-9s %6lu %10u %8.1f %9.1f %9llu %9.1f %9.3f %6s\n", names[method],
+         rtt_ms, handshakes,
+         handshakes ? handshake_us / 1000.0 / handshakes : 0.0,
+         upload_us / 1000.0 / UPLOADS, stats.commands,
+         stats.link_open_us / 1000000.0, charge_uc / 1000.0,
+         ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  if (argc > 1) {
+    baud = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 HTTPS upload benchmark, %d uploads of %d bytes, "
+         "%lu baud\n\n", UPLOADS, BODY_LENGTH, baud);
+  printf("%-9s %6s %10s %8s %9s %9s %9s %9s %6s\n", "method", "rtt ms",
+         "handshakes", "hs ms", "upload ms", "commands", "link s",
+         "charge mC", "result");
+  for (size_t r = 0; r < sizeof(rtts_ms) / sizeof(rtts_ms[0]); r++) {
+    run(baud, rtts_ms[r], TCP_CLOSE);
+    run(baud, rtts_ms[r], SSL_CLOSE);
+    run(baud, rtts_ms[r], SSL_KEEP);
+    run(baud, rtts_ms[r], SSL_SPLIT);
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * A 32KB file upload: chunks through a RAM buffer, then LiteESP8266Upload.
+ *
+ * - chunked: the usual way.  One POST, with the file read 128 bytes at a time
+ *   into a buffer and send()ing each chunk - a send command per chunk.
+ * - streamed: LiteESP8266Upload, copying from the source to the radio in 2048
+ *   byte sends.
+ * - dropped: as streamed, but the connection drops 40% of the way in.  The
+ *   next attempt asks the server where it got to, and resumes there.
+ * - lost: as dropped, and the server also loses the last 1000 bytes the
+ *   radio acknowledged - as happens when a drop catches data in flight.
+ * - unasked: as lost, resuming straight from the radio's acknowledged offset
+ *   without asking.  The server answers that attempt with a 409 and its own
+ *   offset - but only once the whole body has gone out.
+ * - short: as streamed, but the file gives out 60% of the way in (a failing
+ *   card).  The upload has to fail, leaving the server nothing but file data.
+ * - misread: as streamed, but one read fails halfway, in the middle of a send
+ *   the file said it had.  The rest of that send goes out as nulls, and the
+ *   next attempt has to resume from before them.
+ *
+ * The server checks the file it ends up with.  Reports the AT commands sent,
+ * attempts, the SRAM the method needs on an AVR, and the simulated time.
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc extras/host/host_arduino.cpp \
+ *     extras/host/sim_radio.cpp src/LiteESP8266Client.cpp \
+ *     src/LiteESP8266Energy.cpp src/LiteESP8266Upload.cpp \
+ *     extras/bench/upload_bench.cpp -o upload_bench
+ * ./upload_bench [baud]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Client.h>
+#include <LiteESP8266Upload.h>
+
+#include "../host/sim_radio.h"
+
+#include <stdio.h>
+
+#include <string>
+
+const char ssid[] PROGMEM = "Ferret";
+const char password[] PROGMEM = "bilbowasmyfirstferret";
+const char host[] PROGMEM = "192.168.0.118";
+const char path[] PROGMEM = "/upload";
+
+const char chunked_request[] PROGMEM =
+    "POST /upload HTTP/1.1\r\nHost: 192.168.0.118\r\n"
+    "Connection: close\r\nContent-Length: ";
+
+#define FILE_BYTES 32768UL
+#define CHUNK_BYTES 128
+#define MAX_ATTEMPTS 4
+
+#define SERVER_HEADERS \
+    "Date: Sat, 24 Dec 2016 20:33:00 GMT\r\nServer: nginx/1.10.3\r\n"
+
+// On an AVR: the upload object.  The response is read without a buffer.
+#define AVR_UPLOAD_BYTES 12
+
+// A file in memory, with the seek() an SD File has.  A read can be set to
+// fail once, as a card's can.
+class MemoryFile : public Stream {
+public:
+  explicit MemoryFile(const std::string &data)
+      : data_(data), position_(0), fail_at_(data.size()) {}
+  void seek(unsigned long position) { position_ = position; }
+  void fail_once_at(unsigned long position) { fail_at_ = position; }
+  int available() { return data_.size() - position_; }
+  int read() {
+    if (position_ == fail_at_) {
+      fail_at_ = data_.size();
+      return -1;
+    }
+    return position_ < data_.size() ? (uint8_t)data_[position_++] : -1;
+  }
+  int peek() {
+    return position_ < data_.size() ? (uint8_t)data_[position_] : -1;
+  }
+  size_t write(uint8_t c) { (void)c; return 0; }
+
+private:
+  std::string data_;
+  size_t position_;
+  size_t fail_at_;
+};
+
+// Keeps X-Upload-Offset bytes and appends the body, as the header describes.
+// Its responses start with Date and Server, as nginx's and Apache's do.
+struct Server {
+  std::string stored;
+  unsigned long lose_on_drop;
+};
+
+static unsigned long header_number(const std::string &request,
+        const char *name, unsigned long missing) {
+  size_t at = request.find(name);
+  return at == std::string::npos ? missing :
+      strtoul(request.c_str() + at + strlen(name), NULL, 10);
+}
+
+static std::string upload_handler(const std::string &request, void *context) {
+  Server *server = (Server *)context;
+  size_t end = request.find("\r\n\r\n");
+  unsigned long offset = header_number(request, "X-Upload-Offset: ", 0);
+  unsigned long content_length = header_number(request, "Content-Length: ",
+      0);
+  std::string body = request.substr(end + 4);
+
+  if (request.compare(0, 4, "HEAD") == 0) {
+    char response[192];
+    snprintf(response, sizeof(response),
+             "HTTP/1.1 200 OK\r\n" SERVER_HEADERS
+             "X-Upload-Offset: %zu\r\n"
+             "Content-Length: 0\r\nConnection: close\r\n\r\n",
+             server->stored.size());
+    return response;
+  }
+  if (offset > server->stored.size()) {
+    char response[192];
+    snprintf(response, sizeof(response),
+             "HTTP/1.1 409 Conflict\r\n" SERVER_HEADERS
+             "X-Upload-Offset: %zu\r\n"
+             "Content-Length: 0\r\nConnection: close\r\n\r\n",
+             server->stored.size());
+    return response;
+  }
+  server->stored.resize(offset);
+  server->stored += body;
+
+  if (body.size() < content_length) {
+    // Cut off by a drop.  Maybe lose some of it, too.
+    size_t lose = server->lose_on_drop < server->stored.size() ?
+        server->lose_on_drop : server->stored.size();
+    server->stored.resize(server->stored.size() - lose);
+    return "";
+  }
+  return "HTTP/1.1 200 OK\r\n" SERVER_HEADERS
+      "Content-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+enum Method { CHUNKED, STREAMED, DROPPED, LOST, UNASKED, SHORT, MISREAD };
+
+static bool upload_chunked(LiteESP8266 &radio, MemoryFile &file) {
+  char buffer[CHUNK_BYTES + 1];
+  char length[16];
+
+  snprintf(length, sizeof(length), "%lu\r\n\r\n", FILE_BYTES);
+  if (!radio.connect_progmem(host, 80) ||
+          !radio.send_progmem(chunked_request) || !radio.send(length)) {
+    return false;
+  }
+  for (unsigned long sent = 0; sent < FILE_BYTES; sent += CHUNK_BYTES) {
+    for (int i = 0; i < CHUNK_BYTES; i++) {
+      buffer[i] = file.read();
+    }
+    buffer[CHUNK_BYTES] = 0;
+    if (!radio.send(buffer)) {
+      return false;
+    }
+  }
+  char *response = radio.get_response_packet(64);
+  bool ok = response && strstr(response, " 200 ");
+  free(response);
+  radio.close();
+  return ok;
+}
+
+static void run(unsigned long baud, Method method) {
+  static const char *const names[] = { "chunked", "streamed", "dropped",
+      "lost", "unasked", "short", "misread" };
+  SimRadio sim;
+  SimRadioConfig config = sim.config();
+  config.baud = baud;
+  sim.configure(config);
+
+  std::string data;
+  for (unsigned long i = 0; i < FILE_BYTES; i++) {
+    data += (char)('A' + (i * 7) % 26);
+  }
+  MemoryFile file(method == SHORT ? data.substr(0, FILE_BYTES * 6 / 10) :
+                  data);
+  if (method == MISREAD) {
+    file.fail_once_at(FILE_BYTES / 2 + 100);
+  }
+  Server server;
+  server.lose_on_drop = (method == LOST || method == UNASKED) ? 1000 : 0;
+  sim.set_http_handler(upload_handler, &server);
+  sim.set_keep_partial_requests(true);
+
+  LiteESP8266 radio;
+  if (!radio.begin(&sim) || !radio.set_station_mode() ||
+          !radio.connect_to_ap(ssid, password)) {
+    printf("radio setup failed\n");
+    return;
+  }
+
+  sim.reset_stats();
+  uint64_t start_us = host_clock_us();
+  unsigned int attempts = 0, ram;
+  bool ok = false;
+
+  if (method == CHUNKED) {
+    attempts = 1;
+    ok = upload_chunked(radio, file);
+    ram = CHUNK_BYTES + 1;
+  } else {
+    if (method != STREAMED && method != SHORT && method != MISREAD) {
+      sim.drop_link_after(FILE_BYTES * 4 / 10);
+    }
+    LiteESP8266Upload upload;
+    unsigned long offset = 0;
+    while (!ok && attempts < MAX_ATTEMPTS) {
+      attempts++;
+      file.seek(offset);
+      ok = upload.upload(&radio, host, 80, path, &file, FILE_BYTES, offset) ==
+          LITE_ESP8266_SUCCESS;
+      if (!ok && method != UNASKED) {
+        upload.query_offset(&radio, host, 80, path);
+      }
+      offset = upload.acknowledged_offset();
+    }
+    ram = AVR_UPLOAD_BYTES;
+  }
+
+  if (method == SHORT) {
+    // Anything the server has must be the file's.
+    ok = !ok && data.compare(0, server.stored.size(), server.stored) == 0;
+  } else {
+    ok = ok && server.stored == data;
+  }
+  printf("%-10s %9llu %9u %6u %10.1f %6s\n", names[method],
+         sim.stats().commands, attempts, ram,
+         (host_clock_us() - start_us) / 1000.0, ok ? "ok" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 115200;
+  if (argc > 1) {
+    baud = strtoul(argv[1], NULL, 10);
+  }
+
+  printf("LiteESP8266 upload benchmark, %lu bytes, %lu baud\n\n", FILE_BYTES,
+         baud);
+  printf("%-10s %9s %9s %6s %10s %6s\n", "method", "commands", "attempts",
+         "ram", "wall ms", "result");
+  run(baud, CHUNKED);
+  run(baud, STREAMED);
+  run(baud, DROPPED);
+  run(baud, LOST);
+  run(baud, UNASKED);
+  run(baud, SHORT);
+  run(baud, MISREAD);
+  return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Minimal Arduino core stand-in for building the library on a desktop host.
+ *
+ * This is NOT an Arduino emulator.  It provides just enough of the Arduino
+ * API (Print, Stream, PROGMEM helpers, millis and friends) for the library
+ * sources to compile unmodified with g++, so the parsers can be benchmarked
+ * and exercised against simulated radios in extras/.
+ *
+ * Time is virtual.  millis() and micros() read a 64-bit microsecond clock that
+ * only moves when something advances it: every millis()/micros() call ticks it
+ * by HOST_POLL_COST_US, delay() jumps it, and simulated radios fast forward it
+ * while waiting for bytes.  This keeps busy-wait timeouts in the library
+ * working, and lets days of runtime be simulated in seconds.
+ */
+
+#ifndef _LITE_HOST_ARDUINO_H_
+#define _LITE_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+// With LITE_HOST_SIM_HEAP, malloc() and free() use the simulated AVR heap in
+// sim_heap.h, so fragmentation shows up as it would on the board.
+#ifdef LITE_HOST_SIM_HEAP
+#include "sim_heap.h"
+#define malloc(size) sim_heap_malloc(size)
+#define free(pointer) sim_heap_free(pointer)
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+
+// Program memory is just memory on the host.
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcat_P strcat
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strncasecmp_P strncasecmp
+#define strstr_P strstr
+#define memcpy_P memcpy
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Number conversions provided by avr-libc but not glibc.
+char *itoa(int value, char *buffer, int radix);
+char *utoa(unsigned int value, char *buffer, int radix);
+char *ltoa(long value, char *buffer, int radix);
+char *ultoa(unsigned long value, char *buffer, int radix);
+
+// Cost, in virtual microseconds, of a single millis()/micros() poll.
+#define HOST_POLL_COST_US 1
+
+// Virtual time.
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Read, set, and advance the 64-bit virtual clock (in microseconds).
+uint64_t host_clock_us();
+void host_set_clock_us(uint64_t now_us);
+void host_advance_us(uint64_t delta_us);
+
+// Pin functions record state so simulated hardware can look at it.
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Interrupt control is a no-op on the host.
+#define cli()
+#define sei()
+#define noInterrupts()
+#define interrupts()
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+
+  size_t print(const __FlashStringHelper *str);
+  size_t print(const char *str);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println();
+  template <typename T> size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T> size_t println(T value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+#endif // _LITE_HOST_ARDUINO_H_
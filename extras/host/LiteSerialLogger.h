@@ -0,0 +1,11 @@
+/**
+ * Placeholder for the LiteSerialLogger header on host builds.  The library
+ * includes it, but host tools report through stdio instead.
+ */
+
+#ifndef _LITE_HOST_LITESERIALLOGGER_H_
+#define _LITE_HOST_LITESERIALLOGGER_H_
+
+#include <Arduino.h>
+
+#endif // _LITE_HOST_LITESERIALLOGGER_H_
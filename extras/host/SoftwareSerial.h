@@ -0,0 +1,34 @@
+/**
+ * SoftwareSerial stand-in for host builds.  There are no pins on the host, so
+ * this port never receives anything and discards writes.  Host tools pass a
+ * simulated radio to LiteESP8266::begin(Stream *) instead.
+ */
+
+#ifndef _LITE_HOST_SOFTWARESERIAL_H_
+#define _LITE_HOST_SOFTWARESERIAL_H_
+
+#include <Arduino.h>
+
+class SoftwareSerial : public Stream {
+public:
+  SoftwareSerial(uint8_t receive_pin, uint8_t transmit_pin) {
+    (void)receive_pin;
+    (void)transmit_pin;
+  }
+  void begin(long speed) { (void)speed; }
+  bool listen() { return true; }
+  bool isListening() { return true; }
+  bool overflow() { return false; }
+  void end() {}
+
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t c) {
+    (void)c;
+    return 1;
+  }
+  using Print::write;
+};
+
+#endif // _LITE_HOST_SOFTWARESERIAL_H_
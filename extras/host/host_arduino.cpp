@@ -0,0 +1,158 @@
+/**
+ * Implementation of the host Arduino stand-in.  See Arduino.h in this
+ * directory for what is (and is not) provided.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+
+// =============================================================================
+// Virtual clock.
+// =============================================================================
+
+static uint64_t virtual_clock_us = 0;
+
+uint64_t host_clock_us() {
+  return virtual_clock_us;
+}
+
+void host_set_clock_us(uint64_t now_us) {
+  virtual_clock_us = now_us;
+}
+
+void host_advance_us(uint64_t delta_us) {
+  virtual_clock_us += delta_us;
+}
+
+// Both truncate to 32 bits, so they roll over exactly like the AVR versions.
+unsigned long millis() {
+  virtual_clock_us += HOST_POLL_COST_US;
+  return (uint32_t)(virtual_clock_us / 1000);
+}
+
+unsigned long micros() {
+  virtual_clock_us += HOST_POLL_COST_US;
+  return (uint32_t)virtual_clock_us;
+}
+
+void delay(unsigned long ms) {
+  virtual_clock_us += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  virtual_clock_us += us;
+}
+
+// =============================================================================
+// Pins.
+// =============================================================================
+
+static uint8_t pin_values[256];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pin_values[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin_values[pin];
+}
+
+// =============================================================================
+// avr-libc number conversions.
+// =============================================================================
+
+char *ultoa(unsigned long value, char *buffer, int radix) {
+  char digits[33];
+  int length = 0;
+
+  do {
+    int digit = value % radix;
+    digits[length++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+    value /= radix;
+  } while (value);
+
+  for (int i = 0; i < length; i++) {
+    buffer[i] = digits[length - 1 - i];
+  }
+  buffer[length] = 0;
+  return buffer;
+}
+
+char *ltoa(long value, char *buffer, int radix) {
+  if (value < 0 && radix == 10) {
+    buffer[0] = '-';
+    ultoa(-(unsigned long)value, buffer + 1, radix);
+    return buffer;
+  }
+  return ultoa((unsigned long)value, buffer, radix);
+}
+
+char *utoa(unsigned int value, char *buffer, int radix) {
+  // utoa works on 16-bit values on the AVR.
+  return ultoa((uint16_t)value, buffer, radix);
+}
+
+char *itoa(int value, char *buffer, int radix) {
+  return ltoa((int16_t)value, buffer, radix);
+}
+
+// =============================================================================
+// Print.
+// =============================================================================
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (size--) {
+    written += write(*buffer++);
+  }
+  return written;
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return print(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const char *str) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  char buffer[34];
+  return write(ltoa(value, buffer, base));
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char buffer[33];
+  return write(ultoa(value, buffer, base));
+}
+
+size_t Print::print(double value, int digits) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return write(buffer);
+}
+
+size_t Print::println() {
+  return write((uint8_t)'\r') + write((uint8_t)'\n');
+}
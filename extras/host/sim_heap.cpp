@@ -0,0 +1,167 @@
+/**
+ * The simulated AVR heap.  See sim_heap.h.
+ *
+ * Chunk offsets and sizes are kept in maps on the side rather than in the
+ * arena, but the arithmetic is the AVR's: every chunk costs its size plus a 2
+ * byte header.
+ */
+
+#include "sim_heap.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <map>
+
+// The AVR's size_t, in front of every chunk.
+#define SIM_HEAP_HEADER 2
+
+// The smallest free chunk: the header, and the free list's next pointer.
+#define SIM_HEAP_MIN_CHUNK 4
+
+static uint8_t *arena = NULL;
+static size_t arena_size = 0;
+static size_t heap_top = 0;
+
+// Chunk offset (of its header) to data size.
+static std::map<size_t, size_t> free_chunks;
+static std::map<size_t, size_t> used_chunks;
+
+static SimHeapStats heap_stats;
+
+void sim_heap_configure(size_t size) {
+  delete[] arena;
+  arena = new uint8_t[size];
+  arena_size = size;
+  heap_top = 0;
+  free_chunks.clear();
+  used_chunks.clear();
+  heap_stats = SimHeapStats();
+  heap_stats.size = size;
+}
+
+void *sim_heap_malloc(size_t size) {
+  std::map<size_t, size_t>::iterator best = free_chunks.end();
+  size_t offset;
+
+  heap_stats.allocations++;
+  if (size < SIM_HEAP_MIN_CHUNK - SIM_HEAP_HEADER) {
+    size = SIM_HEAP_MIN_CHUNK - SIM_HEAP_HEADER;
+  }
+
+  // An exact fit, or else the smallest that's bigger.
+  for (std::map<size_t, size_t>::iterator chunk = free_chunks.begin();
+       chunk != free_chunks.end(); ++chunk) {
+    if (chunk->second == size) {
+      best = chunk;
+      break;
+    }
+    if (chunk->second > size &&
+        (best == free_chunks.end() || chunk->second < best->second)) {
+      best = chunk;
+    }
+  }
+
+  if (best != free_chunks.end()) {
+    if (best->second - size < SIM_HEAP_MIN_CHUNK) {
+      // Too little left over to be a chunk: hand out all of it.
+      offset = best->first;
+      size = best->second;
+      free_chunks.erase(best);
+    } else {
+      // Split, handing out the top end.
+      best->second -= size + SIM_HEAP_HEADER;
+      offset = best->first + SIM_HEAP_HEADER + best->second;
+    }
+  } else {
+    if (heap_top + SIM_HEAP_HEADER + size > arena_size) {
+      heap_stats.failures++;
+      return NULL;
+    }
+    offset = heap_top;
+    heap_top += SIM_HEAP_HEADER + size;
+    if (heap_top > heap_stats.high_water) {
+      heap_stats.high_water = heap_top;
+    }
+  }
+
+  used_chunks[offset] = size;
+  return arena + offset + SIM_HEAP_HEADER;
+}
+
+void sim_heap_free(void *pointer) {
+  uint8_t *bytes = (uint8_t *)pointer;
+  std::map<size_t, size_t>::iterator used, chunk, next;
+
+  if (!pointer) {
+    return;
+  }
+  if (!arena || bytes < arena || bytes >= arena + arena_size) {
+    // Not ours.
+    free(pointer);
+    return;
+  }
+  used = used_chunks.find(bytes - arena - SIM_HEAP_HEADER);
+  if (used == used_chunks.end()) {
+    return;
+  }
+
+  chunk = free_chunks.insert(*used).first;
+  used_chunks.erase(used);
+
+  // Merge with the chunk after, then the one before.
+  next = chunk;
+  ++next;
+  if (next != free_chunks.end() &&
+      chunk->first + SIM_HEAP_HEADER + chunk->second == next->first) {
+    chunk->second += SIM_HEAP_HEADER + next->second;
+    free_chunks.erase(next);
+  }
+  if (chunk != free_chunks.begin()) {
+    std::map<size_t, size_t>::iterator previous = chunk;
+    --previous;
+    if (previous->first + SIM_HEAP_HEADER + previous->second == chunk->first) {
+      previous->second += SIM_HEAP_HEADER + chunk->second;
+      free_chunks.erase(chunk);
+      chunk = previous;
+    }
+  }
+
+  // A free chunk at the top goes back to unused space.
+  if (chunk->first + SIM_HEAP_HEADER + chunk->second == heap_top) {
+    heap_top = chunk->first;
+    free_chunks.erase(chunk);
+  }
+}
+
+SimHeapStats sim_heap_stats() {
+  SimHeapStats current = heap_stats;
+
+  current.in_use = 0;
+  for (std::map<size_t, size_t>::iterator chunk = used_chunks.begin();
+       chunk != used_chunks.end(); ++chunk) {
+    current.in_use += SIM_HEAP_HEADER + chunk->second;
+  }
+  current.blocks_in_use = used_chunks.size();
+  current.free_bytes = arena_size - current.in_use;
+
+  current.largest_free = 0;
+  if (arena_size - heap_top > SIM_HEAP_HEADER) {
+    current.largest_free = arena_size - heap_top - SIM_HEAP_HEADER;
+  }
+  for (std::map<size_t, size_t>::iterator chunk = free_chunks.begin();
+       chunk != free_chunks.end(); ++chunk) {
+    if (chunk->second > current.largest_free) {
+      current.largest_free = chunk->second;
+    }
+  }
+  return current;
+}
+
+double sim_heap_fragmentation(const SimHeapStats &stats) {
+  if (stats.free_bytes <= SIM_HEAP_HEADER) {
+    return 0.0;
+  }
+  return 100.0 * (1.0 - (double)(stats.largest_free + SIM_HEAP_HEADER) /
+                  stats.free_bytes);
+}
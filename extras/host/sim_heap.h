@@ -0,0 +1,51 @@
+/**
+ * A simulated AVR heap, for host builds.
+ *
+ * On the host, malloc() has gigabytes and never fragments in any way that
+ * matters.  On an Uno the heap is whatever SRAM is left between the globals
+ * and the stack - often under a kilobyte - and a buffer that outlives the
+ * ones allocated after it leaves a hole.  Build with -DLITE_HOST_SIM_HEAP and
+ * the host Arduino.h sends malloc() and free() here, in every file that
+ * includes it: the library, and the sketch freeing what the library returned.
+ *
+ * The allocator follows avr-libc's: a 2 byte size header on each chunk, a free
+ * list in address order with neighbours merged, the smallest free chunk that
+ * fits (split if the rest is big enough to be a chunk), and otherwise growing
+ * the heap top.  The size is what would be left between the globals and the
+ * stack's margin; the heap is empty until sim_heap_configure() sets it.
+ *
+ * Pointers from the real malloc() can be passed to sim_heap_free() - they go
+ * back to the real free().
+ */
+
+#ifndef _LITE_HOST_SIM_HEAP_H_
+#define _LITE_HOST_SIM_HEAP_H_
+
+#include <stddef.h>
+
+struct SimHeapStats {
+  size_t size;              // Heap size.
+  size_t in_use;            // Bytes allocated, headers included.
+  size_t free_bytes;        // Free list and unused top, headers included.
+  size_t largest_free;      // The largest malloc() that would succeed.
+  size_t high_water;        // Highest the heap top has been.
+  size_t blocks_in_use;     // Allocations not yet freed.
+  unsigned long long allocations;
+  unsigned long long failures;    // malloc() calls that returned NULL.
+};
+
+// Empty the heap, and give it size bytes.  Outstanding pointers are invalid.
+void sim_heap_configure(size_t size);
+
+void *sim_heap_malloc(size_t size);
+void sim_heap_free(void *pointer);
+
+SimHeapStats sim_heap_stats();
+
+/**
+ * How broken up the free space is, in percent: 0 when it's all one block,
+ * approaching 100 as it splits into pieces too small to use.
+ */
+double sim_heap_fragmentation(const SimHeapStats &stats);
+
+#endif // _LITE_HOST_SIM_HEAP_H_
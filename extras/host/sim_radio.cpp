@@ -0,0 +1,742 @@
+/**
+ * Simulated ESP8266 AT firmware.  See sim_radio.h.
+ *
+ * Response formats follow the 1.x AT firmware the library was written
+ * against.
+ */
+
+#include "sim_radio.h"
+
+#include <stdio.h>
+
+// Longest step the clock takes while the library waits for bytes.
+#define SIM_MAX_IDLE_STEP_US 1000ULL
+
+// Delay between "Recv N bytes" and "SEND OK".
+#define SIM_SEND_ACK_US 5000ULL
+
+// Marks the enable pin as unused.
+#define SIM_NO_PIN 0xFF
+
+// The boot ROM's 74880 baud messages, as seen at a normal baud rate.
+#define SIM_BOOT_NOISE_BYTES 40
+#define SIM_BOOT_NOISE_US 30000ULL
+
+static bool starts_with(const std::string &text, const char *prefix) {
+  return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Pulls the first quoted string out of an AT argument list.
+static std::string first_quoted(const std::string &text, size_t from = 0) {
+  size_t open = text.find('"', from);
+  if (open == std::string::npos) {
+    return "";
+  }
+  size_t close = text.find('"', open + 1);
+  if (close == std::string::npos) {
+    return "";
+  }
+  return text.substr(open + 1, close - open - 1);
+}
+
+/**
+ * Default server, matching the test scripts in the ESP8266Client example:
+ * GET /test/get_bytes.php?bytes=N returns N digits with a Content-Length
+ * header, and honors "Range: bytes=a-b" with a 206 (or a 416 past the end).
+ * Anything else returns a 20KB page with no Content-Length, which is what
+ * large sites like www.google.com do.
+ */
+std::string sim_default_http_handler(const std::string &request,
+                                     void *context) {
+  (void)context;
+  std::string body;
+  bool content_length = true;
+  const char *connection =
+      request.find("Connection: keep-alive") == std::string::npos ?
+      "close" : "keep-alive";
+
+  size_t bytes_param = request.find("bytes=");
+  if (request.find("/test/get_bytes.php") != std::string::npos) {
+    unsigned long count = 100;
+    if (bytes_param != std::string::npos) {
+      count = strtoul(request.c_str() + bytes_param + 6, NULL, 10);
+    }
+    for (unsigned long i = 0; i < count; i++) {
+      body += (char)('0' + (i % 10));
+    }
+
+    size_t range = request.find("Range: bytes=");
+    if (range != std::string::npos) {
+      char *end;
+      unsigned long first = strtoul(request.c_str() + range + 13, &end, 10);
+      unsigned long last = strtoul(end + 1, NULL, 10);
+      char header[256];
+      if (first >= count) {
+        snprintf(header, sizeof(header),
+                 "HTTP/1.1 416 Range Not Satisfiable\r\nServer: SimRadio\r\n"
+                 "Content-Range: bytes */%lu\r\nContent-Length: 0\r\n"
+                 "Connection: %s\r\n\r\n", count, connection);
+        return header;
+      }
+      if (last >= count) {
+        last = count - 1;
+      }
+      snprintf(header, sizeof(header),
+               "HTTP/1.1 206 Partial Content\r\nServer: SimRadio\r\n"
+               "Content-Range: bytes %lu-%lu/%lu\r\nContent-Length: %lu\r\n"
+               "Connection: %s\r\nContent-Type: text/html\r\n\r\n",
+               first, last, count, last - first + 1, connection);
+      return header + body.substr(first, last - first + 1);
+    }
+  } else if (starts_with(request, "POST")) {
+    body = "Array\n(\n)\n";
+  } else {
+    content_length = false;
+    while (body.size() < 20000) {
+      body += "<div>The quick brown fox jumps over the lazy dog.</div>\n";
+    }
+  }
+
+  char header[160];
+  if (content_length) {
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 200 OK\r\nServer: SimRadio\r\nContent-Length: %zu\r\n"
+             "Connection: %s\r\nContent-Type: text/html\r\n\r\n",
+             body.size(), connection);
+  } else {
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 200 OK\r\nServer: SimRadio\r\n"
+             "Content-Type: text/html\r\n\r\n");
+  }
+  return header + body;
+}
+
+SimRadio::SimRadio() {
+  SimRadioConfig config;
+  config.baud = 9600;
+  config.rtt_ms = 50;
+  config.command_us = 2000;
+  config.join_ms = 3000;
+  config.ssl_setup_ms = 1500;
+  config.boot_ms = 350;
+  configure(config);
+
+  http_handler_ = sim_default_http_handler;
+  http_context_ = NULL;
+  datagram_handler_ = NULL;
+  datagram_context_ = NULL;
+  capture_ = NULL;
+
+  tx_tail_us_ = 0;
+  accounted_us_ = host_clock_us();
+  send_remaining_ = 0;
+  send_link_ = 0;
+  echo_ = true;
+  passive_ = false;
+  mux_ = false;
+  associated_ = false;
+  for (int i = 0; i < SIM_MAX_LINKS; i++) {
+    links_[i].open = false;
+    links_[i].open_at_us = 0;
+  }
+  closed_link_us_ = 0;
+  drop_armed_ = false;
+  drop_after_bytes_ = 0;
+  keep_partial_ = false;
+  sleep_start_us_ = 0;
+  sleep_end_us_ = 0;
+  enable_pin_ = SIM_NO_PIN;
+  powered_ = true;
+  reset_stats();
+}
+
+void SimRadio::configure(const SimRadioConfig &config) {
+  config_ = config;
+}
+
+void SimRadio::set_http_handler(SimHttpHandler handler, void *context) {
+  http_handler_ = handler;
+  http_context_ = context;
+}
+
+void SimRadio::set_datagram_handler(SimDatagramHandler handler,
+                                    void *context) {
+  datagram_handler_ = handler;
+  datagram_context_ = context;
+}
+
+void SimRadio::drop_link_after(unsigned long long bytes) {
+  drop_armed_ = true;
+  drop_after_bytes_ = bytes;
+}
+
+void SimRadio::set_capture(FILE *capture) {
+  capture_ = capture;
+}
+
+void SimRadio::set_enable_pin(uint8_t pin) {
+  account();
+  enable_pin_ = pin;
+  powered_ = digitalRead(pin) == HIGH;
+}
+
+void SimRadio::check_power() {
+  if (enable_pin_ == SIM_NO_PIN || powered_ == (digitalRead(enable_pin_) ==
+          HIGH)) {
+    return;
+  }
+  account();
+  powered_ = !powered_;
+
+  if (!powered_) {
+    // Everything the radio knew is gone.
+    in_flight_.clear();
+    events_.clear();
+    tx_tail_us_ = host_clock_us();
+    close_all_links(host_clock_us());
+    line_.clear();
+    send_remaining_ = 0;
+    echo_ = true;
+    passive_ = false;
+    mux_ = false;
+    associated_ = false;
+    sleep_end_us_ = 0;
+    return;
+  }
+
+  // Boot: noise from the ROM, then the AT firmware's banner.
+  std::string noise;
+  uint32_t seed = 0x2545F491;
+  for (int i = 0; i < SIM_BOOT_NOISE_BYTES; i++) {
+    seed = seed * 1664525 + 1013904223;
+    noise += (char)(seed >> 24);
+  }
+  emit(noise, SIM_BOOT_NOISE_US);
+  emit("\r\nready\r\n", config_.boot_ms * 1000ULL);
+}
+
+const SimRadioStats &SimRadio::stats() {
+  check_power();
+  account();
+  return stats_;
+}
+
+void SimRadio::reset_stats() {
+  memset(&stats_, 0, sizeof(stats_));
+  accounted_us_ = host_clock_us();
+  closed_link_us_ = 0;
+  for (int i = 0; i < SIM_MAX_LINKS; i++) {
+    if (links_[i].open) {
+      links_[i].open_at_us = accounted_us_;
+    }
+  }
+}
+
+std::string SimRadio::link_prefix(int link) const {
+  if (!mux_) {
+    return "";
+  }
+  char prefix[4];
+  snprintf(prefix, sizeof(prefix), "%d,", link);
+  return prefix;
+}
+
+unsigned long long SimRadio::byte_time_us() const {
+  // Start bit, 8 data bits, stop bit.
+  return 10000000ULL / config_.baud;
+}
+
+bool SimRadio::asleep() const {
+  unsigned long long now = host_clock_us();
+  return now >= sleep_start_us_ && now < sleep_end_us_;
+}
+
+void SimRadio::account() {
+  unsigned long long now = host_clock_us();
+  if (now <= accounted_us_) {
+    return;
+  }
+
+  // Radio-on time is the interval less any overlap with the sleep window.
+  unsigned long long on = powered_ ? now - accounted_us_ : 0;
+  unsigned long long overlap_start =
+      sleep_start_us_ > accounted_us_ ? sleep_start_us_ : accounted_us_;
+  unsigned long long overlap_end = sleep_end_us_ < now ? sleep_end_us_ : now;
+  if (powered_ && overlap_end > overlap_start) {
+    on -= overlap_end - overlap_start;
+  }
+  stats_.radio_on_us += on;
+
+  stats_.link_open_us = closed_link_us_;
+  for (int i = 0; i < SIM_MAX_LINKS; i++) {
+    if (links_[i].open && now > links_[i].open_at_us) {
+      stats_.link_open_us += now - links_[i].open_at_us;
+    }
+  }
+  accounted_us_ = now;
+}
+
+void SimRadio::open_link(int link, unsigned long long at_us) {
+  links_[link].open = true;
+  links_[link].udp = false;
+  links_[link].open_at_us = at_us;
+  links_[link].request.clear();
+}
+
+void SimRadio::close_link(int link, unsigned long long at_us) {
+  if (links_[link].open) {
+    if (at_us > links_[link].open_at_us) {
+      closed_link_us_ += at_us - links_[link].open_at_us;
+    }
+    links_[link].open = false;
+  }
+  links_[link].request.clear();
+  links_[link].held.clear();
+}
+
+void SimRadio::close_all_links(unsigned long long at_us) {
+  for (int i = 0; i < SIM_MAX_LINKS; i++) {
+    close_link(i, at_us);
+  }
+}
+
+bool SimRadio::any_link_open() const {
+  for (int i = 0; i < SIM_MAX_LINKS; i++) {
+    if (links_[i].open) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int SimRadio::parse_link(const std::string &args, std::string *rest) const {
+  if (!mux_) {
+    *rest = args;
+    return 0;
+  }
+  if (args.size() < 2 || args[0] < '0' || args[0] >= '0' + SIM_MAX_LINKS ||
+      args[1] != ',') {
+    return -1;
+  }
+  *rest = args.substr(2);
+  return args[0] - '0';
+}
+
+void SimRadio::emit(const std::string &text, unsigned long long delay_us) {
+  Event event;
+  event.at_us = host_clock_us() + delay_us;
+  event.text = text;
+  event.link = -1;
+  event.close = false;
+  event.push = false;
+  schedule(event);
+}
+
+void SimRadio::schedule(const Event &event) {
+  // Keep the queue in time order, and events at the same time in the order
+  // they were scheduled.
+  std::deque<Event>::iterator position = events_.end();
+  while (position != events_.begin() && (position - 1)->at_us > event.at_us) {
+    --position;
+  }
+  events_.insert(position, event);
+}
+
+void SimRadio::run_events(unsigned long long until_us) {
+  while (!events_.empty() && events_.front().at_us <= until_us) {
+    Event event = events_.front();
+    events_.pop_front();
+    if (event.push && !links_[event.link].open) {
+      // Nobody to push to - the connection went first.
+      continue;
+    }
+    if (event.link >= 0) {
+      links_[event.link].held += event.held;
+      if (event.close) {
+        // The held data survives the close until it's read.
+        std::string held = links_[event.link].held;
+        close_link(event.link, event.at_us);
+        links_[event.link].held = held;
+      }
+    }
+    transmit(event.text, event.at_us);
+  }
+}
+
+void SimRadio::transmit(const std::string &text, unsigned long long at_us) {
+  unsigned long long start = at_us;
+  if (start < tx_tail_us_) {
+    start = tx_tail_us_;
+  }
+
+  for (size_t i = 0; i < text.size(); i++) {
+    if (capture_) {
+      fprintf(capture_, "%.6f,RX,0x%02X\n", start / 1000000.0,
+              (uint8_t)text[i]);
+    }
+    start += byte_time_us();
+    InFlight next = { text[i], start };
+    in_flight_.push_back(next);
+  }
+  tx_tail_us_ = start;
+  stats_.bytes_to_mcu += text.size();
+}
+
+void SimRadio::deliver() {
+  unsigned long long now = host_clock_us();
+  run_events(now);
+  while (!in_flight_.empty() && in_flight_.front().ready_us <= now) {
+    if (rx_buffer_.size() < SIM_RX_BUFFER_SIZE) {
+      rx_buffer_.push_back(in_flight_.front().c);
+    } else {
+      stats_.rx_overflows++;
+    }
+    in_flight_.pop_front();
+  }
+}
+
+int SimRadio::available() {
+  check_power();
+  deliver();
+  if (rx_buffer_.empty()) {
+    // Nothing yet - let time pass, up to the next byte arriving.
+    unsigned long long now = host_clock_us();
+    unsigned long long step = SIM_MAX_IDLE_STEP_US;
+    if (!in_flight_.empty() && in_flight_.front().ready_us - now < step) {
+      step = in_flight_.front().ready_us - now;
+    }
+    if (!events_.empty() && events_.front().at_us > now &&
+        events_.front().at_us - now < step) {
+      step = events_.front().at_us - now;
+    }
+    host_advance_us(step);
+    deliver();
+  }
+  return rx_buffer_.size();
+}
+
+int SimRadio::read() {
+  check_power();
+  deliver();
+  if (rx_buffer_.empty()) {
+    return -1;
+  }
+  char c = rx_buffer_.front();
+  rx_buffer_.pop_front();
+  return (uint8_t)c;
+}
+
+int SimRadio::peek() {
+  deliver();
+  return rx_buffer_.empty() ? -1 : (uint8_t)rx_buffer_.front();
+}
+
+size_t SimRadio::write(uint8_t c) {
+  check_power();
+  deliver();
+
+  if (capture_) {
+    fprintf(capture_, "%.6f,TX,0x%02X\n", host_clock_us() / 1000000.0, c);
+  }
+
+  // SoftwareSerial runs with interrupts off while it sends a byte, so anything
+  // arriving in that window is lost.
+  unsigned long long end = host_clock_us() + byte_time_us();
+  run_events(end);
+  while (!in_flight_.empty() && in_flight_.front().ready_us < end) {
+    stats_.rx_lost_during_tx++;
+    in_flight_.pop_front();
+  }
+  host_set_clock_us(end);
+  stats_.bytes_from_mcu++;
+
+  if (!powered_ || asleep()) {
+    return 1;
+  }
+
+  if (send_remaining_) {
+    send_data_ += (char)c;
+    if (--send_remaining_ == 0) {
+      process_send_data();
+    }
+    return 1;
+  }
+
+  line_ += (char)c;
+  if (line_.size() >= 2 && line_.compare(line_.size() - 2, 2, "\r\n") == 0) {
+    std::string line = line_.substr(0, line_.size() - 2);
+    line_.clear();
+    if (echo_) {
+      emit(line + "\r\n");
+    }
+    process_command(line);
+  }
+  return 1;
+}
+
+void SimRadio::process_command(const std::string &line) {
+  unsigned long long latency = config_.command_us;
+  unsigned long long rtt = config_.rtt_ms * 1000ULL;
+
+  stats_.commands++;
+
+  if (line == "AT") {
+    emit("\r\nOK\r\n", latency);
+  } else if (line == "ATE0") {
+    echo_ = false;
+    emit("\r\nOK\r\n", latency);
+  } else if (line == "ATE1") {
+    echo_ = true;
+    emit("\r\nOK\r\n", latency);
+  } else if (line == "AT+RST") {
+    emit("\r\nOK\r\n", latency);
+    close_all_links(host_clock_us());
+    associated_ = false;
+    echo_ = true;
+    mux_ = false;
+    emit("\r\n ets Jan  8 2013,rst cause:2, boot mode:(3,6)\r\n\r\nready\r\n",
+         300000);
+  } else if (line == "AT+GMR") {
+    emit("AT version:1.3.0.0(Jul 14 2016 18:54:01)\r\n"
+         "SDK version:2.0.0(656edbf)\r\n"
+         "compile time:Jul 19 2016 18:43:55\r\n"
+         "OK\r\n", latency);
+  } else if (starts_with(line, "AT+GSLP=")) {
+    unsigned long long sleep_ms = strtoull(line.c_str() + 8, NULL, 10);
+    std::string response = line.substr(8) + "\r\n\r\nOK\r\n";
+    emit(response, latency);
+    close_all_links(host_clock_us());
+    associated_ = false;
+    mux_ = false;
+    // Asleep once the OK is out.
+    sleep_start_us_ = host_clock_us() + latency +
+        response.size() * byte_time_us();
+    sleep_end_us_ = sleep_start_us_ + sleep_ms * 1000ULL;
+  } else if (starts_with(line, "AT+UART_DEF=") ||
+             starts_with(line, "AT+RFPOWER=") ||
+             starts_with(line, "AT+CWMODE_DEF=") ||
+             starts_with(line, "AT+CWDHCP_DEF=")) {
+    emit("\r\nOK\r\n", latency);
+  } else if (starts_with(line, "AT+CWJAP_DEF=")) {
+    associated_ = true;
+    emit("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n",
+         config_.join_ms * 1000ULL);
+  } else if (line == "AT+CWQAP") {
+    associated_ = false;
+    close_all_links(host_clock_us());
+    emit("\r\nOK\r\nWIFI DISCONNECT\r\n", latency);
+  } else if (line == "AT+CIFSR") {
+    emit(associated_ ?
+         "+CIFSR:STAIP,\"192.168.0.120\"\r\n"
+         "+CIFSR:STAMAC,\"18:fe:34:9f:bb:18\"\r\n\r\nOK\r\n" :
+         "+CIFSR:STAIP,\"0.0.0.0\"\r\n"
+         "+CIFSR:STAMAC,\"18:fe:34:9f:bb:18\"\r\n\r\nOK\r\n", latency);
+  } else if (starts_with(line, "AT+CIPDOMAIN=")) {
+    // Names under the common top level domains resolve; anything else fails.
+    std::string domain = first_quoted(line);
+    size_t dot = domain.rfind('.');
+    std::string tld = (dot == std::string::npos) ? "" : domain.substr(dot);
+    if (associated_ && (tld == ".com" || tld == ".org" || tld == ".net")) {
+      emit("+CIPDOMAIN:216.58.216.142\r\n\r\nOK\r\n", latency + rtt);
+    } else {
+      emit("DNS Fail\r\n\r\nERROR\r\n", latency + rtt);
+    }
+  } else if (starts_with(line, "AT+CIPMUX=")) {
+    if (any_link_open()) {
+      emit("link is builded\r\n\r\nERROR\r\n", latency);
+    } else {
+      mux_ = (line[10] == '1');
+      emit("\r\nOK\r\n", latency);
+    }
+  } else if (starts_with(line, "AT+CIPSTART=")) {
+    std::string args;
+    int link = parse_link(line.substr(12), &args);
+    if (link < 0 || !associated_) {
+      emit("\r\nERROR\r\n", latency);
+    } else if (links_[link].open) {
+      emit("ALREADY CONNECTED\r\n\r\nERROR\r\n", latency);
+    } else {
+      // TCP is one round trip.  SSL adds two more and the crypto.  UDP
+      // doesn't wait for anything.
+      bool udp = starts_with(args, "\"UDP\"");
+      unsigned long long setup = latency + (udp ? 0 : rtt);
+      if (starts_with(args, "\"SSL\"")) {
+        setup += 2 * rtt + config_.ssl_setup_ms * 1000ULL;
+      }
+      emit(link_prefix(link) + "CONNECT\r\n\r\nOK\r\n", setup);
+      open_link(link, host_clock_us() + setup);
+      links_[link].udp = udp;
+    }
+  } else if (line == "AT+CIPCLOSE" || starts_with(line, "AT+CIPCLOSE=")) {
+    std::string args;
+    int link = (line == "AT+CIPCLOSE") ? (mux_ ? -1 : 0) :
+        (mux_ ? parse_link(line.substr(12) + ",", &args) : -1);
+    if (link >= 0 && links_[link].open) {
+      if (keep_partial_ &&
+          links_[link].request.find("\r\n\r\n") != std::string::npos) {
+        http_handler_(links_[link].request, http_context_);
+      }
+      close_link(link, host_clock_us());
+      emit(link_prefix(link) + "CLOSED\r\n\r\nOK\r\n", latency);
+    } else {
+      emit("\r\nERROR\r\n", latency);
+    }
+  } else if (starts_with(line, "AT+CIPSEND=")) {
+    std::string args;
+    int link = parse_link(line.substr(11), &args);
+    if (link < 0 || !links_[link].open) {
+      emit("link is not valid\r\n\r\nERROR\r\n", latency);
+    } else {
+      send_link_ = link;
+      send_remaining_ = strtoul(args.c_str(), NULL, 10);
+      send_data_.clear();
+      emit("\r\nOK\r\n> ", latency);
+    }
+  } else if (starts_with(line, "AT+CIPSSLSIZE=")) {
+    unsigned long size = strtoul(line.c_str() + 14, NULL, 10);
+    emit(size >= 2048 && size <= 4096 ? "\r\nOK\r\n" : "\r\nERROR\r\n",
+         latency);
+  } else if (starts_with(line, "AT+CIPSSLCSNI=")) {
+    // As on the ESP-AT 2.x firmware.  The name goes in the next handshake.
+    emit("\r\nOK\r\n", latency);
+  } else if (starts_with(line, "AT+CIPRECVMODE=")) {
+    passive_ = (line[15] == '1');
+    emit("\r\nOK\r\n", latency);
+  } else if (line == "AT+CIPRECVLEN?") {
+    // One per link, as 1.7 firmware answers with multiple connections or
+    // without.  The single connection is link 0.
+    std::string lengths = "+CIPRECVLEN:";
+    for (int i = 0; i < SIM_MAX_LINKS; i++) {
+      char length[12];
+      snprintf(length, sizeof(length), i ? ",%zu" : "%zu",
+               links_[i].held.size());
+      lengths += length;
+    }
+    emit(lengths + "\r\n\r\nOK\r\n", latency);
+  } else if (starts_with(line, "AT+CIPRECVDATA=")) {
+    std::string args;
+    int link = parse_link(line.substr(15), &args);
+    if (link < 0) {
+      emit("\r\nERROR\r\n", latency);
+    } else {
+      size_t wanted = strtoul(args.c_str(), NULL, 10);
+      std::string data = links_[link].held.substr(0, wanted);
+      links_[link].held.erase(0, data.size());
+      char prefix[32];
+      snprintf(prefix, sizeof(prefix), "+CIPRECVDATA,%zu:", data.size());
+      emit(prefix + data + "\r\nOK\r\n", latency);
+    }
+  } else {
+    emit("\r\nERROR\r\n", latency);
+  }
+}
+
+void SimRadio::process_send_data() {
+  char ack[32];
+  snprintf(ack, sizeof(ack), "\r\nRecv %zu bytes\r\n", send_data_.size());
+  emit(ack);
+
+  // Hand complete requests to the server.
+  Link &link = links_[send_link_];
+
+  if (drop_armed_ && send_data_.size() >= drop_after_bytes_) {
+    // The connection goes partway through this send.
+    drop_armed_ = false;
+    link.request += send_data_.substr(0, drop_after_bytes_);
+    http_handler_(link.request, http_context_);
+    close_link(send_link_, host_clock_us());
+    emit("\r\nSEND FAIL\r\n", SIM_SEND_ACK_US);
+    emit(link_prefix(send_link_) + "CLOSED\r\n", SIM_SEND_ACK_US);
+    return;
+  }
+  if (drop_armed_) {
+    drop_after_bytes_ -= send_data_.size();
+  }
+
+  emit("\r\nSEND OK\r\n", SIM_SEND_ACK_US);
+  if (link.udp) {
+    if (datagram_handler_) {
+      datagram_handler_(send_data_, datagram_context_);
+    }
+    return;
+  }
+  link.request += send_data_;
+  size_t end = link.request.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    return;
+  }
+
+  std::string headers = link.request.substr(0, end + 4);
+  size_t body_length = 0;
+  size_t content_length = headers.find("Content-Length: ");
+  if (content_length == std::string::npos) {
+    content_length = headers.find("Content-length: ");
+  }
+  if (content_length != std::string::npos) {
+    body_length = strtoul(headers.c_str() + content_length + 16, NULL, 10);
+  }
+  if (link.request.size() < end + 4 + body_length) {
+    return;
+  }
+
+  std::string request = link.request.substr(0, end + 4 + body_length);
+  link.request.erase(0, end + 4 + body_length);
+  std::string response = http_handler_(request, http_context_);
+
+  // The response starts one RTT after the request went out.  The connection
+  // closes after it, unless the client asked to keep it, or it's an event
+  // stream, which stays open for the server to push more.
+  unsigned long long arrival = host_clock_us() + config_.rtt_ms * 1000ULL;
+  bool close = request.find("Connection: keep-alive") == std::string::npos &&
+      response.find("text/event-stream") == std::string::npos;
+  schedule_server_data(send_link_, response, arrival, false);
+  if (close) {
+    schedule_server_close(send_link_, arrival, false);
+  }
+}
+
+void SimRadio::server_send(int link, const std::string &data,
+                           unsigned long long delay_us) {
+  schedule_server_data(link, data, host_clock_us() + delay_us, true);
+}
+
+void SimRadio::server_close(int link, unsigned long long delay_us) {
+  schedule_server_close(link, host_clock_us() + delay_us, true);
+}
+
+void SimRadio::schedule_server_data(int link, const std::string &data,
+                                    unsigned long long at_us, bool push) {
+  // Split it into full size packets, as the radio would.  In passive mode the
+  // data only becomes available to read when it arrives.
+  std::string tag = mux_ ? link_prefix(link) : "";
+  for (size_t offset = 0; offset < data.size(); offset += SIM_MAX_PACKET) {
+    std::string packet = data.substr(offset, SIM_MAX_PACKET);
+    char ipd[24];
+    Event event;
+    event.at_us = at_us;
+    event.link = link;
+    event.close = false;
+    event.push = push;
+    if (passive_) {
+      // Hold the data, and just say it's here.
+      event.held = packet;
+      snprintf(ipd, sizeof(ipd), "%zu\r\n", packet.size());
+      event.text = "\r\n+IPD," + tag + ipd;
+    } else {
+      snprintf(ipd, sizeof(ipd), "%zu:", packet.size());
+      event.text = "\r\n+IPD," + tag + ipd + packet;
+    }
+    schedule(event);
+  }
+}
+
+void SimRadio::schedule_server_close(int link, unsigned long long at_us,
+                                     bool push) {
+  Event event;
+  event.at_us = at_us;
+  event.link = link;
+  event.close = true;
+  event.push = push;
+  event.text = link_prefix(link) + "CLOSED\r\n";
+  schedule(event);
+}
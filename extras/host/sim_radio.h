@@ -0,0 +1,257 @@
+/**
+ * A simulated ESP8266 running the AT firmware, for host builds.
+ *
+ * SimRadio is a Stream: hand it to LiteESP8266::begin(Stream *) and the
+ * library talks to it exactly as it would to the SoftwareSerial port.  It
+ * models the parts of the real setup that dominate timing:
+ *
+ * - UART pacing.  Every byte costs 10 bit times at the configured baud in both
+ *   directions.  Writes block (as SoftwareSerial writes do), and nothing can be
+ *   received while a byte is being written.
+ * - The 64 byte SoftwareSerial receive buffer.  Bytes arriving while it is
+ *   full are dropped and counted.
+ * - Network round trips.  Connects, DNS lookups and HTTP responses arrive one
+ *   RTT (or several, for SSL) after the request.
+ *
+ * The network side is a single HTTP server; see SimHttpHandler.  UDP links
+ * go to a datagram sink instead; see SimDatagramHandler.  Passive
+ * receive mode (AT+CIPRECVMODE=1) is supported: responses are held on the
+ * radio until fetched with AT+CIPRECVDATA.  So are multiple connections
+ * (AT+CIPMUX=1), with SIM_MAX_LINKS links; responses on different links share
+ * the one UART, in the order the requests completed.
+ *
+ * Time is the virtual clock from the host Arduino.h.  While the library waits
+ * for bytes, available() fast forwards the clock to the next arrival in steps
+ * of at most 1ms, so timeouts still behave.
+ */
+
+#ifndef _LITE_HOST_SIM_RADIO_H_
+#define _LITE_HOST_SIM_RADIO_H_
+
+#include <Arduino.h>
+
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+
+// Size of the SoftwareSerial receive buffer (_SS_MAX_RX_BUFF).
+#define SIM_RX_BUFFER_SIZE 64
+
+// Largest +IPD payload the radio delivers in one packet.
+#define SIM_MAX_PACKET 1460
+
+// Links with AT+CIPMUX=1.
+#define SIM_MAX_LINKS 5
+
+/**
+ * Builds the full HTTP response (headers and body) for a request.  request is
+ * everything the client sent, up to and including the blank line.
+ */
+typedef std::string (*SimHttpHandler)(const std::string &request,
+                                      void *context);
+
+/**
+ * Receives each datagram sent on a UDP link, as it goes out - host_clock_us()
+ * is the send time.  Nothing comes back.
+ */
+typedef void (*SimDatagramHandler)(const std::string &datagram,
+                                   void *context);
+
+// The default handler - see sim_radio.cpp.
+std::string sim_default_http_handler(const std::string &request,
+                                     void *context);
+
+struct SimRadioConfig {
+  unsigned long baud;            // UART baud rate.
+  unsigned long rtt_ms;          // Network round trip time.
+  unsigned long command_us;      // Radio processing time per AT command.
+  unsigned long join_ms;         // Time to associate with the AP.
+  unsigned long ssl_setup_ms;    // Handshake crypto time on top of the RTTs.
+  unsigned long boot_ms;         // Power up to the "ready" banner.
+};
+
+struct SimRadioStats {
+  unsigned long long bytes_to_mcu;       // Bytes the radio sent.
+  unsigned long long bytes_from_mcu;     // Bytes the MCU sent.
+  unsigned long long rx_overflows;       // Dropped on a full RX buffer.
+  unsigned long long rx_lost_during_tx;  // Dropped while the MCU wrote.
+  unsigned long long commands;           // AT commands processed.
+  unsigned long long radio_on_us;        // Time powered and awake.
+  unsigned long long link_open_us;       // Connection time, summed over links.
+};
+
+class SimRadio : public Stream {
+public:
+  SimRadio();
+
+  void configure(const SimRadioConfig &config);
+  const SimRadioConfig &config() const { return config_; }
+
+  void set_http_handler(SimHttpHandler handler, void *context);
+  void set_datagram_handler(SimDatagramHandler handler, void *context);
+
+  /**
+   * Record every byte on the wire to capture, in the CSV format read by
+   * extras/wire_analyzer: "<seconds>,<TX|RX>,0x<byte>", with TX being the
+   * MCU to radio direction.  Pass NULL to stop.
+   */
+  void set_capture(FILE *capture);
+
+  /**
+   * Follow the given pin as the radio's CH_PD/EN line: low is off (no output,
+   * input ignored, all state lost), and going high boots the radio - 74880
+   * baud boot noise, then "ready" after boot_ms.  The radio's power state is
+   * taken from the pin's current level, so set the pin up first.
+   */
+  void set_enable_pin(uint8_t pin);
+
+  /**
+   * Drop the connection once the server has received this many more bytes
+   * from the MCU, as a flaky network would.  The send that crosses the mark
+   * gets "SEND FAIL", then the link reports CLOSED.  The server keeps what
+   * arrived before the drop: the HTTP handler is called with the partial
+   * request, and its response is thrown away.
+   */
+  void drop_link_after(unsigned long long bytes);
+
+  /**
+   * When the MCU closes a connection partway through a request's body, hand
+   * what arrived to the HTTP handler, as drop_link_after() does - a server
+   * that keeps partial uploads.  Off by default: the partial request is lost.
+   */
+  void set_keep_partial_requests(bool keep) { keep_partial_ = keep; }
+
+  /**
+   * The server sends data on an open connection, unasked - a push on an event
+   * stream, say.  It reaches the radio delay_us from now, as "+IPD" packets,
+   * unless the connection has closed by then.  Responses to event stream
+   * requests ("Content-Type: text/event-stream") leave the connection open
+   * for this.
+   */
+  void server_send(int link, const std::string &data,
+                   unsigned long long delay_us);
+
+  // The server closes an open connection, delay_us from now.
+  void server_close(int link, unsigned long long delay_us);
+
+  // Statistics, brought up to the current virtual time.
+  const SimRadioStats &stats();
+  void reset_stats();
+
+  // Stream interface, used by the library.
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t c);
+  using Print::write;
+
+private:
+  struct Event;
+
+  // Queue output to the MCU, starting no earlier than delay_us from now.
+  void emit(const std::string &text, unsigned long long delay_us = 0);
+  // Add an event to the queue.
+  void schedule(const Event &event);
+  // Carry out the events due by until_us.
+  void run_events(unsigned long long until_us);
+  // Put text on the UART, starting at at_us or when it's free.
+  void transmit(const std::string &text, unsigned long long at_us);
+  // Move bytes that have arrived into the receive buffer.
+  void deliver();
+  // Data or a close from the server, due at at_us.  A push is dropped if the
+  // link has closed by then.
+  void schedule_server_data(int link, const std::string &data,
+                            unsigned long long at_us, bool push);
+  void schedule_server_close(int link, unsigned long long at_us, bool push);
+  // Account radio-on and link-open time up to now.
+  void account();
+  // Follow the enable pin, if there is one.
+  void check_power();
+
+  void process_command(const std::string &line);
+  void process_send_data();
+  void open_link(int link, unsigned long long at_us);
+  void close_link(int link, unsigned long long at_us);
+  void close_all_links(unsigned long long at_us);
+  bool any_link_open() const;
+  // Split "<link>,<rest>" in multiple connection mode.  Returns the link, or
+  // -1 if it's missing or out of range, and sets rest to what follows.  In
+  // single connection mode, returns 0 and rest is all of args.
+  int parse_link(const std::string &args, std::string *rest) const;
+  // "<link>," in multiple connection mode, empty otherwise.
+  std::string link_prefix(int link) const;
+  bool asleep() const;
+
+  unsigned long long byte_time_us() const;
+
+  struct InFlight {
+    char c;
+    unsigned long long ready_us;
+  };
+
+  /**
+   * Something the radio will do at a future time - the network answering, a
+   * command finishing.  Output goes on the UART when the event happens, so a
+   * response due in 300ms doesn't hold up a command answered in 2ms.
+   */
+  struct Event {
+    unsigned long long at_us;
+    std::string text;                 // Output to the MCU.
+    int link;                         // Link affected, or -1.
+    std::string held;                 // Passive mode data arriving on link.
+    bool close;                       // The server closes link.
+    bool push;                        // Unasked - only if link is open.
+  };
+
+  struct Link {
+    bool open;
+    bool udp;                         // Sends are datagrams, not HTTP.
+    unsigned long long open_at_us;
+    std::string request;              // HTTP request being assembled.
+    std::string held;                 // Passive mode data not yet fetched.
+  };
+
+  SimRadioConfig config_;
+  SimRadioStats stats_;
+  SimHttpHandler http_handler_;
+  void *http_context_;
+  SimDatagramHandler datagram_handler_;
+  void *datagram_context_;
+  FILE *capture_;
+
+  std::deque<Event> events_;
+  std::deque<InFlight> in_flight_;
+  std::deque<char> rx_buffer_;
+  unsigned long long tx_tail_us_;     // When the radio's UART goes idle.
+  unsigned long long accounted_us_;   // Stats are current up to here.
+
+  std::string line_;                  // Command being received.
+  size_t send_remaining_;             // Bytes left in a CIPSEND.
+  int send_link_;                     // Link the CIPSEND is for.
+  std::string send_data_;             // Data received by CIPSEND.
+
+  // Link 0 is the only link without multiple connections.
+  Link links_[SIM_MAX_LINKS];
+
+  bool echo_;
+  bool passive_;
+  bool mux_;
+  bool associated_;
+  unsigned long long closed_link_us_;  // Total of finished connections.
+
+  // drop_link_after(), while armed.
+  bool drop_armed_;
+  unsigned long long drop_after_bytes_;
+  bool keep_partial_;
+
+  // Power, from the enable pin.
+  uint8_t enable_pin_;
+  bool powered_;
+
+  // Deep sleep window, if any.
+  unsigned long long sleep_start_us_;
+  unsigned long long sleep_end_us_;
+};
+
+#endif // _LITE_HOST_SIM_RADIO_H_
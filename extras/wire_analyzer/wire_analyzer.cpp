@@ -0,0 +1,441 @@
+/**
+ * Wire capture analyzer for the LiteESP8266 AT conversation.
+ *
+ * Reads a TX/RX byte capture from a logic analyzer or serial tap, decodes it
+ * with the library's own command and response strings (LiteESP8266Commands.h)
+ * and prints a per-command timeline: the command, the response that ended it,
+ * how long the radio took, how long the MCU sat between commands, and any
+ * bytes the radio sent while the MCU was transmitting (SoftwareSerial cannot
+ * receive while it sends, so those bytes are lost).  A summary shows where the
+ * capture's time went.
+ *
+ * It does not catch the other way SoftwareSerial loses bytes: its 64 byte RX
+ * buffer overflowing when more arrives than the MCU reads in time - a long
+ * response during a gap between commands, say.  The wire shows when bytes
+ * arrived, not when the MCU read them, and the library reads +IPD data
+ * between commands as well as during them, so no count from the capture
+ * alone would be right.  Check SoftwareSerial::overflow() in the sketch, or
+ * SimRadioStats::rx_overflows in a simulation.
+ *
+ * Capture format is CSV, one byte per line, in any order:
+ *
+ *   <time in seconds>,<TX|RX>,<byte>
+ *
+ * TX is MCU to radio, RX is radio to MCU, the time is the start bit of the
+ * byte, and the byte is 0xNN or decimal.  Lines starting with '#' and lines
+ * that don't parse (column headers) are skipped.  Most analyzer exports can be
+ * massaged into this with a line of awk; the scenario benchmark writes it
+ * directly with SimRadio::set_capture().
+ *
+ * Build and run from the repository root:
+ *
+ * g++ -O2 -std=c++11 -Iextras/host -Isrc \
+ *     extras/wire_analyzer/wire_analyzer.cpp -o wire_analyzer
+ * ./wire_analyzer capture.csv [baud] [idle_gap_ms]
+ */
+
+#include <Arduino.h>
+#include <LiteESP8266Commands.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+struct WireByte {
+  double time;    // Start bit, in seconds.
+  bool tx;        // MCU to radio.
+  uint8_t value;
+  bool lost;      // RX byte that overlapped a TX byte.
+};
+
+static bool by_time(const WireByte &a, const WireByte &b) {
+  return a.time < b.time;
+}
+
+// AT+ commands the library sends, from its own tables.
+static const char *const known_commands[] = {
+  ESP8266_COMMAND_RESET,
+  ESP8266_COMMAND_VERSION,
+  ESP8266_COMMAND_DEEP_SLEEP,
+  ESP8266_COMMAND_SET_BAUD,
+  ESP8266_COMMAND_SET_RFPOWER,
+  ESP8266_COMMAND_SET_STATION_MODE,
+  ESP8266_COMMAND_ENABLE_STATION_DHCP,
+  ESP8266_COMMAND_CONNECT_TO_AP,
+  ESP8266_COMMAND_DISCONNET_FROM_AP,
+  ESP8266_COMMAND_DNS_LOOKUP,
+  ESP8266_COMMAND_GET_LOCAL_IP,
+  ESP8266_COMMAND_MULTIPLE_CONNECTIONS,
+  ESP8266_COMMAND_CONNECT,
+  ESP8266_COMMAND_CLOSE_LINK,
+  ESP8266_COMMAND_CLOSE_CONNECTION,
+  ESP8266_COMMAND_SEND_DATA,
+  ESP8266_COMMAND_RECEIVE_MODE,
+  ESP8266_COMMAND_RECEIVE_LENGTH,
+  ESP8266_COMMAND_RECEIVE_DATA,
+  ESP8266_COMMAND_SSL_BUFFER_SIZE,
+  ESP8266_COMMAND_SSL_SNI,
+};
+
+// The last number in an argument list: "<len>" or "<link>,<len>".
+static unsigned long last_number(const char *arguments) {
+  const char *comma = strrchr(arguments, ',');
+  return strtoul(comma ? comma + 1 : arguments, NULL, 10);
+}
+
+// Responses that end a command.
+static const char *const final_responses[] = {
+  ESP8266_RESPONSE_OK,
+  ESP8266_RESPONSE_ERROR,
+  ESP8266_RESPONSE_FAIL,
+  ESP8266_SEND_OK,
+};
+
+static bool parse_line(const char *line, WireByte *out) {
+  char direction[8];
+  char value[16];
+  double time;
+
+  if (line[0] == '#') {
+    return false;
+  }
+  if (sscanf(line, " %lf , %7[A-Za-z] , %15s", &time, direction, value) != 3) {
+    return false;
+  }
+  out->time = time;
+  out->tx = (direction[0] == 'T' || direction[0] == 't');
+  out->value = (uint8_t)strtoul(value, NULL, 0);
+  out->lost = false;
+  return true;
+}
+
+// Short, printable name for a command line, e.g. "CIPSTART=".
+static std::string command_name(const std::string &line) {
+  std::string prefix = ESP8266_COMMAND_PREFIX;
+  if (line == ESP8266_TEST || line == ESP8266_COMMAND_DISABLE_ECHO) {
+    return line;
+  }
+  if (line.compare(0, prefix.size(), prefix) == 0) {
+    std::string rest = line.substr(prefix.size());
+    for (size_t i = 0; i < sizeof(known_commands) / sizeof(char *); i++) {
+      if (rest.compare(0, strlen(known_commands[i]), known_commands[i]) == 0) {
+        return known_commands[i];
+      }
+    }
+    // Not one of ours - name it up to the parameters.
+    return rest.substr(0, rest.find_first_of("=?"));
+  }
+  return "?";
+}
+
+static std::string printable(const std::string &text, size_t max_length) {
+  std::string out;
+  for (size_t i = 0; i < text.size() && out.size() < max_length; i++) {
+    char c = text[i];
+    if (c == '\r') {
+      out += "\\r";
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c < 32 || c > 126) {
+      out += '.';
+    } else {
+      out += c;
+    }
+  }
+  if (text.size() > max_length) {
+    out += "...";
+  }
+  return out;
+}
+
+struct CommandStats {
+  unsigned long count;
+  double total_ms;
+  double max_ms;
+  unsigned long lost;
+};
+
+// A timeline row.  A command's row is only complete when its response
+// arrives, after rows that start later, so rows are collected and sorted by
+// their start before printing.
+struct Row {
+  double start_ms;
+  std::string text;
+};
+
+static bool by_start(const Row &a, const Row &b) {
+  return a.start_ms < b.start_ms;
+}
+
+// Add a row: the start column, then the rest from format.
+static void add_row(std::vector<Row> *rows, double start_ms,
+        const char *format, ...) {
+  char text[160];
+  va_list arguments;
+
+  va_start(arguments, format);
+  vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+
+  Row row;
+  row.start_ms = start_ms;
+  row.text = text;
+  rows->push_back(row);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s capture.csv [baud] [idle_gap_ms]\n", argv[0]);
+    return 1;
+  }
+  unsigned long baud = (argc > 2) ? strtoul(argv[2], NULL, 10) : 9600;
+  double idle_gap = ((argc > 3) ? atof(argv[3]) : 50.0) / 1000.0;
+  double byte_time = 10.0 / baud;
+
+  FILE *capture = fopen(argv[1], "r");
+  if (!capture) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  std::vector<WireByte> bytes;
+  char line[128];
+  while (fgets(line, sizeof(line), capture)) {
+    WireByte next;
+    if (parse_line(line, &next)) {
+      bytes.push_back(next);
+    }
+  }
+  fclose(capture);
+
+  if (bytes.empty()) {
+    fprintf(stderr, "No bytes found in %s\n", argv[1]);
+    return 1;
+  }
+  std::stable_sort(bytes.begin(), bytes.end(), by_time);
+
+  // Mark RX bytes that overlap a TX byte.  TX bytes are in time order, so walk
+  // them alongside.
+  unsigned long total_lost = 0;
+  {
+    std::vector<double> tx_times;
+    for (size_t i = 0; i < bytes.size(); i++) {
+      if (bytes[i].tx) {
+        tx_times.push_back(bytes[i].time);
+      }
+    }
+    for (size_t i = 0; i < bytes.size(); i++) {
+      if (bytes[i].tx) {
+        continue;
+      }
+      // Bytes that merely touch end to end don't count.
+      double slack = byte_time / 100;
+      std::vector<double>::iterator next = std::lower_bound(tx_times.begin(),
+          tx_times.end(), bytes[i].time - byte_time + slack);
+      if (next != tx_times.end() &&
+          *next < bytes[i].time + byte_time - slack) {
+        bytes[i].lost = true;
+        total_lost++;
+      }
+    }
+  }
+
+  printf("%10s %10s  %-14s %-24s %-9s %9s %9s %5s\n", "start ms", "gap ms",
+         "command", "detail", "result", "wait ms", "first ms", "lost");
+
+  std::vector<Row> rows;
+  std::map<std::string, CommandStats> per_command;
+  std::string tx_line, rx_line;
+  unsigned long payload_remaining = 0;   // CIPSEND data still to come.
+  unsigned long ipd_remaining = 0;       // +IPD data still to come.
+  double ipd_start = 0;
+  std::string ipd_header;
+
+  // The command waiting for its final response.
+  bool pending = false;
+  std::string pending_name, pending_line;
+  double pending_start = 0, pending_sent = 0, pending_first = -1;
+  double pending_gap = 0;
+  unsigned long pending_lost = 0;
+  bool pending_is_send = false;
+
+  double capture_start = bytes.front().time;
+  double capture_end = bytes.back().time + byte_time;
+  double last_activity = capture_start;
+  double last_complete = capture_start;
+  double wait_total = 0, mcu_gap_total = 0, idle_total = 0;
+  double tx_busy = 0, rx_busy = 0;
+  unsigned long ipd_packets = 0, ipd_bytes = 0;
+
+  for (size_t i = 0; i < bytes.size(); i++) {
+    const WireByte &b = bytes[i];
+    char c = (char)b.value;
+
+    // Silence while a command is outstanding is the radio's time, and shows up
+    // in that command's wait.  Silence otherwise is the MCU's.
+    if (!pending && b.time - last_activity > idle_gap) {
+      add_row(&rows, (last_activity - capture_start) * 1000,
+              " %10s  -- idle %.1f ms --\n", "",
+              (b.time - last_activity) * 1000);
+      idle_total += b.time - last_activity;
+    }
+    if (b.time + byte_time > last_activity) {
+      last_activity = b.time + byte_time;
+    }
+
+    if (b.tx) {
+      tx_busy += byte_time;
+      if (payload_remaining) {
+        payload_remaining--;
+        continue;
+      }
+      if (tx_line.empty() && !pending) {
+        pending_gap = std::max(0.0, b.time - last_complete);
+        pending_start = b.time;
+      }
+      tx_line += c;
+      if (tx_line.size() >= 2 && tx_line.compare(tx_line.size() - 2, 2,
+              CRLF) == 0) {
+        std::string command = tx_line.substr(0, tx_line.size() - 2);
+        tx_line.clear();
+        if (pending) {
+          // A new command before the last one finished - report it unfinished.
+          add_row(&rows, (pending_start - capture_start) * 1000,
+                  " %10.1f  %-14s %-24s %-9s\n", pending_gap * 1000,
+                  pending_name.c_str(), printable(pending_line, 24).c_str(),
+                  "(none)");
+          pending_gap = 0;
+          pending_start = b.time - (command.size() + 1) * byte_time;
+        }
+        pending = true;
+        pending_line = command;
+        pending_name = command_name(command);
+        pending_sent = b.time + byte_time;
+        pending_first = -1;
+        pending_lost = 0;
+        pending_is_send = (pending_name == ESP8266_COMMAND_SEND_DATA);
+        mcu_gap_total += pending_gap;
+        if (pending_is_send) {
+          payload_remaining = last_number(command.c_str() +
+              strlen(ESP8266_COMMAND_PREFIX) +
+              strlen(ESP8266_COMMAND_SEND_DATA));
+        }
+      }
+      continue;
+    }
+
+    // RX.
+    rx_busy += byte_time;
+    if (b.lost) {
+      pending_lost++;
+    }
+    if (pending && pending_first < 0) {
+      pending_first = b.time;
+    }
+
+    if (ipd_remaining) {
+      if (--ipd_remaining == 0) {
+        add_row(&rows, (ipd_start - capture_start) * 1000,
+                " %10s  %-14s %-24s %-9s %9.1f\n", "", "  (data)",
+                printable(ipd_header, 24).c_str(), "", (b.time + byte_time -
+                ipd_start) * 1000);
+      }
+      continue;
+    }
+
+    rx_line += c;
+
+    // +IPD,[<link>,]<length>: is followed by raw data, not lines.
+    if (c == ':' && rx_line.find(ESP8266_DATA_PACKET) != std::string::npos) {
+      size_t start = rx_line.find(ESP8266_DATA_PACKET);
+      ipd_header = rx_line.substr(start);
+      ipd_remaining = last_number(rx_line.c_str() + start +
+          strlen(ESP8266_DATA_PACKET));
+      ipd_start = b.time - (ipd_header.size() - 1) * byte_time;
+      ipd_packets++;
+      ipd_bytes += ipd_remaining;
+      rx_line.clear();
+      continue;
+    }
+
+    if (c != '\n') {
+      continue;
+    }
+
+    bool is_final = false;
+    for (size_t r = 0; r < sizeof(final_responses) / sizeof(char *); r++) {
+      if (rx_line == final_responses[r]) {
+        is_final = true;
+      }
+    }
+    // CIPSEND answers OK twice over: once for the prompt, then SEND OK.
+    if (is_final && pending_is_send && rx_line == ESP8266_RESPONSE_OK) {
+      is_final = false;
+    }
+
+    if (is_final && pending) {
+      double wait = b.time + byte_time - pending_sent;
+      std::string result = rx_line.substr(0, rx_line.size() - 2);
+      add_row(&rows, (pending_start - capture_start) * 1000,
+              " %10.1f  %-14s %-24s %-9s %9.1f %9.1f %5lu\n",
+              pending_gap * 1000, pending_name.c_str(),
+              printable(pending_line, 24).c_str(), result.c_str(),
+              wait * 1000, std::max(0.0, pending_first - pending_sent) * 1000,
+              pending_lost);
+
+      CommandStats &stats = per_command[pending_name];
+      stats.count++;
+      stats.total_ms += wait * 1000;
+      stats.max_ms = std::max(stats.max_ms, wait * 1000);
+      stats.lost += pending_lost;
+      wait_total += wait;
+
+      pending = false;
+      pending_lost = 0;
+      last_complete = b.time + byte_time;
+    } else if (!pending && rx_line != CRLF) {
+      // Unsolicited - CLOSED, WIFI DISCONNECT, ready, boot noise.
+      add_row(&rows, (b.time - capture_start) * 1000,
+              " %10s  %-14s %-24s\n", "", "  (radio)",
+              printable(rx_line, 24).c_str());
+    }
+    rx_line.clear();
+  }
+
+  // Ties keep the order the rows were found in.
+  std::stable_sort(rows.begin(), rows.end(), by_start);
+  for (size_t i = 0; i < rows.size(); i++) {
+    printf("%10.1f%s", rows[i].start_ms, rows[i].text.c_str());
+  }
+
+  double total = capture_end - capture_start;
+  printf("\nCapture: %.1f ms, %zu bytes at %lu baud\n", total * 1000,
+         bytes.size(), baud);
+  printf("  waiting on the radio: %9.1f ms (%4.1f%%)\n", wait_total * 1000,
+         100 * wait_total / total);
+  printf("  MCU between commands: %9.1f ms (%4.1f%%)\n", mcu_gap_total * 1000,
+         100 * mcu_gap_total / total);
+  printf("  line idle > %.0f ms:   %9.1f ms (%4.1f%%)\n", idle_gap * 1000,
+         idle_total * 1000, 100 * idle_total / total);
+  printf("  TX busy:              %9.1f ms (%4.1f%%)\n", tx_busy * 1000,
+         100 * tx_busy / total);
+  printf("  RX busy:              %9.1f ms (%4.1f%%)\n", rx_busy * 1000,
+         100 * rx_busy / total);
+  printf("  +IPD packets: %lu, %lu bytes\n", ipd_packets, ipd_bytes);
+  printf("  RX bytes lost while MCU transmitted: %lu\n\n", total_lost);
+
+  printf("%-14s %6s %10s %10s %10s %6s\n", "command", "count", "total ms",
+         "mean ms", "max ms", "lost");
+  for (std::map<std::string, CommandStats>::iterator it = per_command.begin();
+       it != per_command.end(); ++it) {
+    const CommandStats &stats = it->second;
+    printf("%-14s %6lu %10.1f %10.1f %10.1f %6lu\n", it->first.c_str(),
+           stats.count, stats.total_ms, stats.total_ms / stats.count,
+           stats.max_ms, stats.lost);
+  }
+  return 0;
+}
@@ -3,55 +3,13 @@
 
 #include "LiteESP8266Client.h"
 #include "LiteSerialLogger.h"
+#include "LiteESP8266Commands.h"
+#include "LiteESP8266Energy.h"
 
-// AT test commands and prefix.
-const char ESP8266_TEST[] PROGMEM = "AT";  // Test AT startup
-const char ESP8266_COMMAND_PREFIX[] PROGMEM = "AT+";
-const char ESP8266_COMMAND_DISABLE_ECHO[] PROGMEM = "ATE0";
-
-// AT commands.  ? or = is included after them if needed, and optionally the
-// fixed parameters.
-const char ESP8266_COMMAND_RESET[] PROGMEM = "RST";
-const char ESP8266_COMMAND_VERSION[] PROGMEM = "GMR";
-const char ESP8266_COMMAND_DEEP_SLEEP[] PROGMEM = "GSLP=";
-const char ESP8266_COMMAND_SET_BAUD[] PROGMEM = "UART_DEF=";
-const char ESP8266_COMMAND_SET_RFPOWER[] PROGMEM = "RFPOWER=";
-const char ESP8266_COMMAND_SET_STATION_MODE[] PROGMEM = "CWMODE_DEF=1";
-const char ESP8266_COMMAND_ENABLE_STATION_DHCP[] PROGMEM = "CWDHCP_DEF=1,1";
-const char ESP8266_COMMAND_CONNECT_TO_AP[] PROGMEM = "CWJAP_DEF=";
-const char ESP8266_COMMAND_DISCONNET_FROM_AP[] PROGMEM = "CWQAP";
-const char ESP8266_COMMAND_DNS_LOOKUP[] PROGMEM = "CIPDOMAIN=";
-const char ESP8266_COMMAND_GET_LOCAL_IP[] PROGMEM = "CIFSR";
-const char ESP8266_COMMAND_CONNECT[] PROGMEM = "CIPSTART=";
-const char ESP8266_COMMAND_CLOSE_CONNECTION[] PROGMEM = "CIPCLOSE";
-const char ESP8266_COMMAND_SEND_DATA[] PROGMEM = "CIPSEND=";
-
-// Commands are terminated with CRLF.
-const char CRLF[] PROGMEM = "\r\n";
-
-// Serial options beyond baud.  8,N,1 with no flow control is sane.
-const char ESP8266_SERIAL_OPTIONS[] PROGMEM = ",8,1,0,0";
-
-// Assorted responses one might look for.
-const char ESP8266_RESPONSE_OK[] PROGMEM = "OK\r\n";
-const char ESP8266_RESPONSE_ERROR[] PROGMEM = "ERROR\r\n";
-const char ESP8266_RESPONSE_FAIL[] PROGMEM = "FAIL\r\n";
-const char ESP8266_DNS_LOOKUP_PREFIX[] PROGMEM = "+CIPDOMAIN:";
-const char ESP8266_LOCAL_IP_ADDRESS[] PROGMEM = ":STAIP,";
-const char ESP8266_SEND_OK[] PROGMEM = "SEND OK\r\n";
-const char ESP8266_DATA_PACKET[] PROGMEM = "+IPD,";
-const char ESP8266_CONTENT_LENGTH_HEADER[] PROGMEM = "Content-Length: ";
-
-// Terminates HTTP header section, opens content section.
-const char ESP8266_CRLFCRLF[] PROGMEM = "\r\n\r\n";
-
-// Connection types - with quotes and commas!
-const char ESP8266_TCP[] PROGMEM = "\"TCP\",";
-const char ESP8266_UDP[] PROGMEM = "\"UDP\",";
-const char ESP8266_SSL[] PROGMEM = "\"SSL\",";
-
-// Set to the maximum command length (above), with terminating null.
-#define MAX_COMMAND_LENGTH 16
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#include <avr/interrupt.h>
+#endif
 
 
 // =============================================================================
@@ -60,14 +18,18 @@ const char ESP8266_SSL[] PROGMEM = "\"SSL\",";
 
 
 LiteESP8266::LiteESP8266() {
-  // Ensure radio_serial_ is null - allows detecting if it has been set.
+  // Ensure the serial pointers are null - allows detecting if they are set.
   radio_serial_ = NULL;
+  software_serial_ = NULL;
+  enable_pin_ = LITE_ESP8266_NO_PIN;
+  energy_meter_ = NULL;
 }
 
 LiteESP8266::~LiteESP8266() {
-  // If radio_serial_ has been allocated, delete it.
-  if (radio_serial_) {
-    delete radio_serial_;
+  // If software_serial_ has been allocated, delete it.  radio_serial_ is
+  // either the same object or a stream owned by the caller.
+  if (software_serial_) {
+    delete software_serial_;
   }
 }
 
@@ -76,12 +38,14 @@ bool LiteESP8266::begin(unsigned long baud_rate, byte tx_pin, byte rx_pin) {
   bool radio_is_alive = false;
   
   // Create a SoftwareSerial object if one does not already exist.
-  if (!radio_serial_) {
-    radio_serial_ = new SoftwareSerial(tx_pin, rx_pin);
+  if (!software_serial_) {
+    software_serial_ = new SoftwareSerial(tx_pin, rx_pin);
   }
   
   // Configure SoftwareSerial to the desired baud rate.
-  radio_serial_->begin(baud_rate);
+  software_serial_->begin(baud_rate);
+  radio_serial_ = software_serial_;
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
 
   // Send the "AT" and look for an "OK" response.
   radio_is_alive = test();
@@ -94,6 +58,17 @@ bool LiteESP8266::begin(unsigned long baud_rate, byte tx_pin, byte rx_pin) {
   return false;
 }
 
+bool LiteESP8266::begin(Stream *radio_stream) {
+  // The caller has already configured the stream - just use it.
+  radio_serial_ = radio_stream;
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
+
+  if (test()) {
+    return init_radio();
+  }
+  return false;
+}
+
 bool LiteESP8266::init_radio() {
   return disable_echo();
 }
@@ -111,6 +86,60 @@ bool LiteESP8266::reset_radio() {
   return (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS);
 }
 
+// The AT firmware prints "ready" once booted.  The boot ROM noise before it
+// never matches, so this just looks for the banner.
+bool LiteESP8266::wait_for_ready(const unsigned int timeout_ms) {
+  if (read_for_response(ESP8266_RESPONSE_READY, timeout_ms) ==
+          LITE_ESP8266_SUCCESS) {
+    // Booted, whether from power on, reset or the end of a deep sleep.
+    set_radio_state(LITE_ESP8266_STATE_IDLE);
+    return true;
+  }
+  return false;
+}
+
+void LiteESP8266::set_enable_pin(const byte enable_pin) {
+  enable_pin_ = enable_pin;
+  digitalWrite(enable_pin_, HIGH);
+  pinMode(enable_pin_, OUTPUT);
+}
+
+bool LiteESP8266::power_on_radio(const unsigned int timeout_ms) {
+  if (enable_pin_ == LITE_ESP8266_NO_PIN || !radio_serial_) {
+    return false;
+  }
+
+  if (digitalRead(enable_pin_) == HIGH) {
+    // Already on - set_enable_pin() turns it on, for one.  It won't say
+    // "ready" again unless it reboots.
+    digitalWrite(enable_pin_, LOW);
+    set_radio_state(LITE_ESP8266_STATE_OFF);
+    delay(RADIO_RESTART_OFF_MS);
+  }
+
+  // Drop anything left over from before the radio was turned off.
+  while (radio_serial_->available()) {
+    radio_serial_->read();
+  }
+
+  digitalWrite(enable_pin_, HIGH);
+  // RF calibration at boot draws about what receiving does.
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+  if (!wait_for_ready(timeout_ms)) {
+    return false;
+  }
+  return init_radio();
+}
+
+bool LiteESP8266::power_off_radio() {
+  if (enable_pin_ == LITE_ESP8266_NO_PIN) {
+    return false;
+  }
+  digitalWrite(enable_pin_, LOW);
+  set_radio_state(LITE_ESP8266_STATE_OFF);
+  return true;
+}
+
 bool LiteESP8266::disable_echo() {
   send_command(ESP8266_COMMAND_DISABLE_ECHO);
   return (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS);
@@ -161,7 +190,11 @@ bool LiteESP8266::deep_sleep_radio(const unsigned long sleep_time_ms) {
   // before the radio goes to sleep.
   send_command_with_prefix(ESP8266_COMMAND_DEEP_SLEEP, sleep_time_mills_ascii);
 
-  return (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS);
+  if (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS) {
+    set_radio_state(LITE_ESP8266_STATE_DEEP_SLEEP);
+    return true;
+  }
+  return false;
 }
 
 bool LiteESP8266::set_radio_baud(const unsigned long baud) {
@@ -188,6 +221,174 @@ bool LiteESP8266::set_rfpower(const uint8_t rfpower) {
   return (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS);  
 }
 
+// =============================================================================
+// Passive receive mode, and sleeping until the radio has something.
+// =============================================================================
+
+bool LiteESP8266::set_passive_receive(const bool passive) {
+  char mode[2] = { passive ? '1' : '0', 0 };
+
+  send_command_with_prefix(ESP8266_COMMAND_RECEIVE_MODE, mode);
+  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK,
+          ESP8266_RESPONSE_ERROR));
+}
+
+/**
+ * Response, one length per link, with or without multiple connections:
+ * +CIPRECVLEN:1460,0,0,0,0
+ *
+ * OK
+ *
+ * Without multiple connections, the first is the connection's.
+ */
+bool LiteESP8266::get_passive_receive_length(unsigned int *length,
+        const uint8_t link_id) {
+  char length_buffer[6];
+  uint8_t link = (link_id == LITE_ESP8266_NO_LINK) ? 0 : link_id;
+
+  send_command_with_prefix(ESP8266_COMMAND_RECEIVE_LENGTH);
+  if (read_for_responses(ESP8266_RECEIVE_LENGTH_PREFIX, ESP8266_RESPONSE_ERROR)
+          != LITE_ESP8266_SUCCESS) {
+    return false;
+  }
+
+  // Skip the links before the one wanted.
+  for (uint8_t i = 0; i < link; i++) {
+    read_until(',');
+  }
+
+  // The length is terminated by a ',', or \r after the last link.
+  if (copy_serial_to_buffer(length_buffer,
+          (link < LITE_ESP8266_MAX_LINKS - 1) ? ',' : '\r',
+          sizeof(length_buffer)) != LITE_ESP8266_SUCCESS) {
+    return false;
+  }
+  *length = atoi(length_buffer);
+
+  // And the links after it.
+  if (link < LITE_ESP8266_MAX_LINKS - 1) {
+    read_until('\r');
+  }
+  return (read_for_response(ESP8266_RESPONSE_OK) == LITE_ESP8266_SUCCESS);
+}
+
+/**
+ * Response:
+ * +CIPRECVDATA,<actual_len>:<data>
+ * OK
+ */
+unsigned int LiteESP8266::read_passive_data(char *buffer,
+        const unsigned int buffer_size, const unsigned int timeout_ms,
+        const uint8_t link_id) {
+  // Room for "4,2048".
+  char length_buffer[8];
+  unsigned int data_length, bytes_read = 0;
+  unsigned long start_time = millis();
+
+  link_id_prefix(length_buffer, link_id);
+  utoa(buffer_size, length_buffer + strlen(length_buffer), 10);
+  send_command_with_prefix(ESP8266_COMMAND_RECEIVE_DATA, length_buffer);
+  if (read_for_responses(ESP8266_RECEIVE_DATA_PREFIX, ESP8266_RESPONSE_ERROR,
+          timeout_ms) != LITE_ESP8266_SUCCESS) {
+    return 0;
+  }
+
+  copy_serial_to_buffer(length_buffer, ':', sizeof(length_buffer));
+  data_length = atoi(length_buffer);
+
+  for (unsigned int i = 0; i < data_length; i++) {
+    // Loop until data is ready, unless the timeout is exceeded.
+    while (!radio_serial_->available() &&
+            (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms));
+    if (LITE_ESP8266_ELAPSED_MS(start_time) >= timeout_ms) {
+      return bytes_read;
+    }
+    // The radio never sends more than asked for, but be safe.
+    if (bytes_read < buffer_size) {
+      buffer[bytes_read++] = radio_serial_->read();
+    } else {
+      radio_serial_->read();
+    }
+  }
+
+  read_for_response(ESP8266_RESPONSE_OK);
+  return bytes_read;
+}
+
+bool LiteESP8266::sleep_until_radio_data() {
+#if defined(__AVR__)
+  unsigned long quiet_since;
+
+  // Only the built-in SoftwareSerial port has a pin change interrupt to wake
+  // on.  Listening (re)arms it.
+  if (!software_serial_ || radio_serial_ != software_serial_) {
+    return false;
+  }
+  software_serial_->listen();
+
+  // Don't sleep if something is already here.  Interrupts are off between the
+  // check and sleeping so a byte can't sneak in between - sleep_cpu() runs
+  // right after sei(), before any interrupt is taken.
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  if (!radio_serial_->available()) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+
+  // Awake.  If the radio did it, more bytes are on the way - wait for them.
+  quiet_since = millis();
+  while (!radio_serial_->available()) {
+    if (LITE_ESP8266_ELAPSED_MS(quiet_since) > WAKE_SETTLE_TIMEOUT) {
+      return false;
+    }
+  }
+
+  // Throw away the wake-up bytes until the line goes quiet.
+  quiet_since = millis();
+  while (LITE_ESP8266_ELAPSED_MS(quiet_since) <= WAKE_SETTLE_TIMEOUT) {
+    if (radio_serial_->available()) {
+      radio_serial_->read();
+      quiet_since = millis();
+    }
+  }
+  return true;
+#else
+  // No power down sleep to offer here.
+  return false;
+#endif
+}
+
+// =============================================================================
+// Energy accounting.
+// =============================================================================
+
+void LiteESP8266::set_energy_meter(LiteESP8266EnergyMeter *energy_meter) {
+  energy_meter_ = energy_meter;
+}
+
+void LiteESP8266::set_radio_state(const uint8_t state) {
+  if (energy_meter_) {
+    energy_meter_->set_state(state);
+  }
+}
+
+// =============================================================================
+// Multiple connection helpers.
+// =============================================================================
+
+void LiteESP8266::link_id_prefix(char *buffer, const uint8_t link_id) {
+  buffer[0] = 0;
+  if (link_id != LITE_ESP8266_NO_LINK) {
+    buffer[0] = '0' + link_id;
+    buffer[1] = ',';
+    buffer[2] = 0;
+  }
+}
+
 // =============================================================================
 // SoftwareSerial passthrough operations.  These allow the user of this class to
 // interact with the radio directly if they have a need to.
@@ -204,6 +405,23 @@ void LiteESP8266::write(const char c) {
   radio_serial_->write(c);
 }
 
+void LiteESP8266::write_string(const char *string) {
+  radio_serial_->print(string);
+}
+
+void LiteESP8266::write_progmem(const char *progmem_string) {
+  radio_serial_->print((const __FlashStringHelper *)progmem_string);
+}
+
+uint8_t LiteESP8266::digit_count(unsigned long value) {
+  uint8_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    digits++;
+  }
+  return digits;
+}
+
 // =============================================================================
 // Send commands and look for responses in the SoftwareSerial buffer.
 // =============================================================================
@@ -239,12 +457,14 @@ uint8_t LiteESP8266::read_for_response(const char* progmem_response_string,
   unsigned long start_time = millis();
 
   // Loop until the timeout is reached.
-  while (millis() < (start_time + timeout_ms)) {
+  while (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms) {
     // Only proceed if a character is available.
     if (radio_serial_->available()) {
+      uint8_t next_character = radio_serial_->read();
+
       // If the character matches the expected character in the response,
       // increment the pointer.  If not, reset things.
-      if (radio_serial_->read() == 
+      if (next_character == 
               pgm_read_byte_near(progmem_response_string + matched_chars)) {
         matched_chars++;
    
@@ -252,8 +472,10 @@ uint8_t LiteESP8266::read_for_response(const char* progmem_response_string,
           return LITE_ESP8266_SUCCESS;
         }
       } else {
-        // Character did not match - reset.
-        matched_chars = 0;
+        // Character did not match - reset.  It may still start a new match,
+        // though: noise ending in 'r' right before "ready" must not hide it.
+        matched_chars = (next_character ==
+                pgm_read_byte_near(progmem_response_string)) ? 1 : 0;
       }
     }
   }
@@ -273,7 +495,7 @@ uint8_t LiteESP8266::read_for_responses(const char* progmem_pass_string,
   unsigned long start_time = millis();
 
   // Loop until the timout is reached.
-  while (millis() < (start_time + timeout_ms)) {
+  while (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms) {
     if (radio_serial_->available()) {
       char next_character = radio_serial_->read();
 
@@ -285,7 +507,8 @@ uint8_t LiteESP8266::read_for_responses(const char* progmem_pass_string,
           return LITE_ESP8266_SUCCESS;
         }
       } else {
-        pass_matched_chars = 0;
+        pass_matched_chars = (next_character ==
+                pgm_read_byte_near(progmem_pass_string)) ? 1 : 0;
       }
 
       // Check and update the "fail" case.
@@ -296,7 +519,8 @@ uint8_t LiteESP8266::read_for_responses(const char* progmem_pass_string,
           return LITE_ESP8266_FAILURE;
         }
       } else {
-        fail_matched_characters = 0;
+        fail_matched_characters = (next_character ==
+                pgm_read_byte_near(progmem_fail_string)) ? 1 : 0;
       }
     }
   }
@@ -312,7 +536,7 @@ uint8_t LiteESP8266::copy_serial_to_buffer(char *buffer,
   uint16_t bytes_read = 0;
 
   // Loop until timeout.
-  while (millis() < (start_time + timeout_ms)) {
+  while (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms) {
     if (radio_serial_->available()) {
       buffer[bytes_read] = radio_serial_->read();
 
@@ -353,7 +577,7 @@ uint8_t LiteESP8266::read_until(const char read_until,
         const unsigned int timeout_ms) {
   unsigned long start_time = millis();
 
-  while (millis() < (start_time + timeout_ms)) {
+  while (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms) {
     if (radio_serial_->available()) {
       // If the character matches the expected termination character, return.
       if (read_until == radio_serial_->read()) {
@@ -390,6 +614,7 @@ bool LiteESP8266::connect_to_ap(const char *progmem_ssid,
   // Password may be 64 characters.
   // BSSID is 17.  Plus all this needs quotes.
   char join_ap_buffer[128];
+  bool success;
 
   memset(join_ap_buffer, 0, sizeof(join_ap_buffer));
 
@@ -422,8 +647,12 @@ bool LiteESP8266::connect_to_ap(const char *progmem_ssid,
   // Join AP either ends in OK or FAIL.
   send_command_with_prefix(ESP8266_COMMAND_CONNECT_TO_AP, join_ap_buffer);
 
-  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+  // Scanning and associating keeps the receiver on.
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+  success = (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
           ESP8266_RESPONSE_FAIL, WIFI_CONNECT_TIMEOUT));
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
+  return success;
 }
 
 bool LiteESP8266::disconnect_from_ap() {
@@ -462,6 +691,7 @@ bool LiteESP8266::dns_lookup(const char *domain, char *ip_address) {
   radio_serial_->println();
 
   // DNS can take a while - give it 30s.
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
   if (read_for_responses(ESP8266_DNS_LOOKUP_PREFIX, ESP8266_RESPONSE_ERROR, 
           WIFI_CONNECT_TIMEOUT) == LITE_ESP8266_SUCCESS) {
     // Success - read the IP and return.
@@ -469,10 +699,12 @@ bool LiteESP8266::dns_lookup(const char *domain, char *ip_address) {
     
     // There's an OK\r\n after this - swallow that and report success.
     read_for_response(ESP8266_RESPONSE_OK);
+    set_radio_state(LITE_ESP8266_STATE_IDLE);
     return true;
   }
   
   // Not successful.  Return false.
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
   return false;
 }
 
@@ -486,14 +718,17 @@ bool LiteESP8266::dns_lookup_progmem(const char *progmem_domain,
   radio_serial_->print('"');
   radio_serial_->println();
 
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
   if (read_for_responses(ESP8266_DNS_LOOKUP_PREFIX, ESP8266_RESPONSE_ERROR, 
           WIFI_CONNECT_TIMEOUT) == LITE_ESP8266_SUCCESS) {
     copy_serial_to_buffer(ip_address, '\r', IP_ADDRESS_LENGTH);
     
     read_for_response(ESP8266_RESPONSE_OK);
+    set_radio_state(LITE_ESP8266_STATE_IDLE);
     return true;
   }
   
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
   return false;
 }
 
@@ -521,25 +756,38 @@ bool LiteESP8266::get_local_ip(char *ip_address) {
 // Connect, send, and receive data from a remote endpoint.
 // =============================================================================
 
+bool LiteESP8266::set_multiple_connections(const bool multiple) {
+  char mode[2] = { multiple ? '1' : '0', 0 };
+
+  send_command_with_prefix(ESP8266_COMMAND_MULTIPLE_CONNECTIONS, mode);
+  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK,
+          ESP8266_RESPONSE_ERROR));
+}
+
 bool LiteESP8266::connect_progmem(const char *progmem_host, 
-        const unsigned int port, const uint8_t protocol) {
+        const unsigned int port, const uint8_t protocol,
+        const uint8_t link_id) {
   char connect_buffer[128];
   char port_to_ascii[6];
+  bool success;
 
   memset(connect_buffer, 0, sizeof(connect_buffer));
 
+  // With multiple connections, the link comes first: 0,"TCP",...
+  link_id_prefix(connect_buffer, link_id);
+
   // Default or unknown is TCP.
   // This inserts "TCP", into the buffer.
   switch (protocol) {
     default:
     case LITE_ESP8266_TCP:
-      strcpy_P(connect_buffer, ESP8266_TCP);
+      strcat_P(connect_buffer, ESP8266_TCP);
       break;
     case LITE_ESP8266_UDP:
-      strcpy_P(connect_buffer, ESP8266_UDP);
+      strcat_P(connect_buffer, ESP8266_UDP);
       break;
     case LITE_ESP8266_SSL:
-      strcpy_P(connect_buffer, ESP8266_SSL);
+      strcat_P(connect_buffer, ESP8266_SSL);
       break;
   }
 
@@ -553,29 +801,37 @@ bool LiteESP8266::connect_progmem(const char *progmem_host,
   strcat(connect_buffer, port_to_ascii);
 
   send_command_with_prefix(ESP8266_COMMAND_CONNECT, connect_buffer);
-  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
-          ESP8266_RESPONSE_ERROR, CLIENT_CONNECT_TIMEOUT));
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+  success = (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+          ESP8266_RESPONSE_ERROR, (protocol == LITE_ESP8266_SSL) ?
+          SSL_CONNECT_TIMEOUT : CLIENT_CONNECT_TIMEOUT));
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
+  return success;
 }
 
 bool LiteESP8266::connect(const char *host, const unsigned int port, 
-        const uint8_t protocol) {
+        const uint8_t protocol, const uint8_t link_id) {
   char connect_buffer[128];
   char port_to_ascii[6];
+  bool success;
 
   memset(connect_buffer, 0, sizeof(connect_buffer));
 
+  // With multiple connections, the link comes first: 0,"TCP",...
+  link_id_prefix(connect_buffer, link_id);
+
   // Default or unknown is TCP.
   // This inserts "TCP", into the buffer.
   switch (protocol) {
     default:
     case LITE_ESP8266_TCP:
-      strcpy_P(connect_buffer, ESP8266_TCP);
+      strcat_P(connect_buffer, ESP8266_TCP);
       break;
     case LITE_ESP8266_UDP:
-      strcpy_P(connect_buffer, ESP8266_UDP);
+      strcat_P(connect_buffer, ESP8266_UDP);
       break;
     case LITE_ESP8266_SSL:
-      strcpy_P(connect_buffer, ESP8266_SSL);
+      strcat_P(connect_buffer, ESP8266_SSL);
       break;
   }
 
@@ -589,76 +845,128 @@ bool LiteESP8266::connect(const char *host, const unsigned int port,
   strcat(connect_buffer, port_to_ascii);
 
   send_command_with_prefix(ESP8266_COMMAND_CONNECT, connect_buffer);
-  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
-          ESP8266_RESPONSE_ERROR, CLIENT_CONNECT_TIMEOUT));
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+  success = (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+          ESP8266_RESPONSE_ERROR, (protocol == LITE_ESP8266_SSL) ?
+          SSL_CONNECT_TIMEOUT : CLIENT_CONNECT_TIMEOUT));
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
+  return success;
 }
 
-bool LiteESP8266::close() {
-  send_command_with_prefix(ESP8266_COMMAND_CLOSE_CONNECTION);
-  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+bool LiteESP8266::set_ssl_buffer_size(const unsigned int size) {
+  char size_ascii[6];
+
+  if (size < LITE_ESP8266_SSL_BUFFER_MIN ||
+          size > LITE_ESP8266_SSL_BUFFER_MAX) {
+    return false;
+  }
+  utoa(size, size_ascii, 10);
+
+  send_command_with_prefix(ESP8266_COMMAND_SSL_BUFFER_SIZE, size_ascii);
+  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK,
           ESP8266_RESPONSE_ERROR));
 }
 
-bool LiteESP8266::send(const char *data) {
-  char length_buffer[6];
+bool LiteESP8266::set_ssl_sni_progmem(const char *progmem_host,
+        const uint8_t link_id) {
+  // Sized like the connect buffer: the same host has to fit both.
+  char sni_buffer[128];
 
-  // Get the data length, in ASCII.
-  utoa(strlen(data), length_buffer, 10);
+  memset(sni_buffer, 0, sizeof(sni_buffer));
 
-  // Attempt to send the data - send a request to send a given length.
-  send_command_with_prefix(ESP8266_COMMAND_SEND_DATA, length_buffer);
-  // Check for OK or ERROR response.
-  if (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
-          ESP8266_RESPONSE_ERROR)) {
-    // Success - send the data!
-    radio_serial_->print(data);
+  // With multiple connections, the link comes first: 0,"example.com"
+  link_id_prefix(sni_buffer, link_id);
+  sni_buffer[strlen(sni_buffer)] = '"';
+  strcat_P(sni_buffer, progmem_host);
+  sni_buffer[strlen(sni_buffer)] = '"';
+
+  send_command_with_prefix(ESP8266_COMMAND_SSL_SNI, sni_buffer);
+  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK,
+          ESP8266_RESPONSE_ERROR));
+}
+
+bool LiteESP8266::close(const uint8_t link_id) {
+  if (link_id != LITE_ESP8266_NO_LINK) {
+    char link_ascii[2] = { (char)('0' + link_id), 0 };
+    send_command_with_prefix(ESP8266_COMMAND_CLOSE_LINK, link_ascii);
   } else {
+    send_command_with_prefix(ESP8266_COMMAND_CLOSE_CONNECTION);
+  }
+  return (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+          ESP8266_RESPONSE_ERROR));
+}
+
+bool LiteESP8266::send(const char *data, const uint8_t link_id) {
+  if (!begin_send(strlen(data), link_id)) {
     // Something went wrong.  Send is not successful.
     return false;
   }
+  radio_serial_->print(data);
+  return end_send();
+}
 
-  // Look for "SEND OK" response.
-  return (LITE_ESP8266_SUCCESS == read_for_response(ESP8266_SEND_OK));
+bool LiteESP8266::send_progmem(const char *data, const uint8_t link_id) {
+  if (!begin_send(strlen_P((const char *)data), link_id)) {
+    return false;
+  }
+  // Cast first to call the proper function.
+  radio_serial_->print((const __FlashStringHelper *)data);
+  return end_send();
 }
 
-bool LiteESP8266::send_progmem(const char *data) {
-  char length_buffer[6];
+bool LiteESP8266::begin_send(const unsigned int length,
+        const uint8_t link_id) {
+  // Room for "4,2048".
+  char length_buffer[8];
 
-  utoa(strlen_P((const char *)data), length_buffer, 10);
+  // Get the data length, in ASCII, after the link if there is one.
+  link_id_prefix(length_buffer, link_id);
+  utoa(length, length_buffer + strlen(length_buffer), 10);
 
-  // Attempt to send the data.
+  // Attempt to send the data - send a request to send a given length.
   send_command_with_prefix(ESP8266_COMMAND_SEND_DATA, length_buffer);
   // Check for OK or ERROR response.
-  if (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_RESPONSE_OK, 
+  if (LITE_ESP8266_SUCCESS != read_for_responses(ESP8266_RESPONSE_OK,
           ESP8266_RESPONSE_ERROR)) {
-    // Success - send the data!  Cast first to call the proper function.
-    radio_serial_->print((const __FlashStringHelper *)data);
-  } else {
-    // Something went wrong.  Send is not successful.
     return false;
   }
-  // Look for "SEND OK" response.
-  return (LITE_ESP8266_SUCCESS == read_for_response(ESP8266_SEND_OK));
+
+  // Success - the data goes next.
+  set_radio_state(LITE_ESP8266_STATE_TX);
+  return true;
+}
+
+bool LiteESP8266::end_send() {
+  bool success;
+
+  // Look for "SEND OK" response - or "SEND FAIL", if the connection dropped.
+  success = (LITE_ESP8266_SUCCESS == read_for_responses(ESP8266_SEND_OK,
+          ESP8266_RESPONSE_FAIL));
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
+  return success;
 }
 
 // Response comes back like this:
 // +IPD,532:<data>
+// Or with multiple connections, tagged with the link:
+// +IPD,0,532:<data>
 char *LiteESP8266::get_response_packet(const unsigned int max_allocate_bytes, 
-        const unsigned int timeout_ms) {
+        const unsigned int timeout_ms, uint8_t *link_id) {
   // Can get up to 2048 bytes of response packet, though you can't fit that in
   // Arduino Uno SRAM.  Realistically, data size is likely to be about 1430.
-  char data_length_buffer[5];
   char *data;
   unsigned long start_time = millis();
 
+  // Waiting on the network - the receiver is on.
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+
   // Read until '+IPD,"
   if (read_for_response(ESP8266_DATA_PACKET, CLIENT_CONNECT_TIMEOUT) == 
           LITE_ESP8266_SUCCESS) {
     unsigned int data_length, bytes_allocated;
     
     // '+IPD,' found - get the data length and proceed.
-    copy_serial_to_buffer(data_length_buffer, ':', sizeof(data_length_buffer));
-    data_length = atoi(data_length_buffer);
+    data_length = read_packet_header(link_id);
 
     // Allocate space - either the data length, or the max allowed bytes.
     // Include space for the null terminator character.
@@ -670,18 +978,24 @@ char *LiteESP8266::get_response_packet(const unsigned int max_allocate_bytes,
       bytes_allocated = max_allocate_bytes;
     }
 
-    memset(data, 0, bytes_allocated);
-    
+    if (data) {
+      memset(data, 0, bytes_allocated);
+    } else {
+      // Out of memory.  Still read the packet, so the next read starts at
+      // whatever follows it, and return NULL.
+      bytes_allocated = 0;
+    }
+
     for (unsigned int i = 0; i < data_length; i++) {
       // Loop until data is ready, unless the timeout is exceeded.
       while (!radio_serial_->available() &&
-              (millis() < (start_time + timeout_ms)));
+              (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms));
       // If the timeout is exceeded, break.
-      if (millis() > (start_time + timeout_ms)) {
+      if (LITE_ESP8266_ELAPSED_MS(start_time) >= timeout_ms) {
         break;
       }
       // Only copy the data if there is enough space.
-      if (i < (bytes_allocated - 1)) {
+      if (i + 1 < bytes_allocated) {
         // Copy the data into the buffer.
         data[i] = radio_serial_->read();
       } else {
@@ -689,12 +1003,66 @@ char *LiteESP8266::get_response_packet(const unsigned int max_allocate_bytes,
         radio_serial_->read();
       }
     }
+    set_radio_state(LITE_ESP8266_STATE_IDLE);
     return data;
   }
   // No +IPD found - return null.
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
   return NULL;
 }
 
+unsigned int LiteESP8266::read_packet_header(uint8_t *link_id) {
+  // "4,2048" is the longest header.
+  char data_length_buffer[8];
+  char *length_start;
+
+  copy_serial_to_buffer(data_length_buffer, ':', sizeof(data_length_buffer));
+
+  // If there is a link, it's before the comma.
+  length_start = strchr(data_length_buffer, ',');
+  if (length_start) {
+    length_start++;
+  } else {
+    length_start = data_length_buffer;
+  }
+  if (link_id) {
+    *link_id = (length_start == data_length_buffer) ? LITE_ESP8266_NO_LINK :
+        atoi(data_length_buffer);
+  }
+  return atoi(length_start);
+}
+
+int LiteESP8266::read_packet_byte(unsigned int *remaining,
+        const unsigned int timeout_ms, uint8_t *link_id) {
+  unsigned long start_time = millis();
+  uint8_t result;
+
+  if (!*remaining) {
+    // Between packets: the next thing of interest is another packet, or the
+    // connection closing.
+    result = read_for_responses(ESP8266_DATA_PACKET, ESP8266_RESPONSE_CLOSED,
+            timeout_ms);
+    if (result == LITE_ESP8266_FAILURE) {
+      return LITE_ESP8266_READ_CLOSED;
+    }
+    if (result != LITE_ESP8266_SUCCESS) {
+      return LITE_ESP8266_READ_TIMEOUT;
+    }
+    *remaining = read_packet_header(link_id);
+    if (!*remaining) {
+      return LITE_ESP8266_READ_TIMEOUT;
+    }
+  }
+
+  while (!radio_serial_->available()) {
+    if (LITE_ESP8266_ELAPSED_MS(start_time) >= timeout_ms) {
+      return LITE_ESP8266_READ_TIMEOUT;
+    }
+  }
+  (*remaining)--;
+  return (uint8_t)radio_serial_->read();
+}
+
 // Similar to above, but only returns the actual HTTP response.
 // Note: This is not using the above to avoid double allocating memory.
 char *LiteESP8266::get_http_response(const unsigned int max_allocate_bytes, 
@@ -703,6 +1071,8 @@ char *LiteESP8266::get_http_response(const unsigned int max_allocate_bytes,
   char *data;
   unsigned long start_time = millis();
 
+  set_radio_state(LITE_ESP8266_STATE_RX_WAIT);
+
   // Read until the Content-Length: header.
   if (read_for_response(ESP8266_CONTENT_LENGTH_HEADER, CLIENT_CONNECT_TIMEOUT) 
           == LITE_ESP8266_SUCCESS) {
@@ -725,18 +1095,23 @@ char *LiteESP8266::get_http_response(const unsigned int max_allocate_bytes,
         bytes_allocated = max_allocate_bytes;
       }
 
-      memset(data, 0, bytes_allocated);
+      if (data) {
+        memset(data, 0, bytes_allocated);
+      } else {
+        // Out of memory - read past the body anyway, and return NULL.
+        bytes_allocated = 0;
+      }
       for (unsigned int i = 0; i < content_length; i++) {
         // Loop until data is ready, unless the timeout is exceeded.
         while (!radio_serial_->available() &&
-                (millis() < (start_time + timeout_ms)));
+                (LITE_ESP8266_ELAPSED_MS(start_time) < timeout_ms));
         // If the timeout is exceeded, break.
-        if (millis() > (start_time + timeout_ms)) {
+        if (LITE_ESP8266_ELAPSED_MS(start_time) >= timeout_ms) {
           break;
         }
         // Copy the data into the buffer.
         // Only copy the data if there is enough space.
-        if (i < (bytes_allocated - 1)) {
+        if (i + 1 < bytes_allocated) {
           // Copy the data into the buffer.
           data[i] = radio_serial_->read();
         } else {
@@ -744,10 +1119,12 @@ char *LiteESP8266::get_http_response(const unsigned int max_allocate_bytes,
           radio_serial_->read();
         }
       }
+      set_radio_state(LITE_ESP8266_STATE_IDLE);
       return data;
     }
   }
   // No Content-Length: header found!
+  set_radio_state(LITE_ESP8266_STATE_IDLE);
   return NULL;
 }
 
@@ -7,8 +7,9 @@
  * ESP8266 libraries (with the Serial class enabled), and you'll see the
  * savings.
  *
- * This library does not include everything.  It is designed for a simple,
- * single connection client.
+ * This library does not include everything.  It is designed for a simple
+ * client - one connection, unless you turn on multiple connections with
+ * set_multiple_connections() (the scheduler and range downloader do).
  *
  * It only supports station mode.  If you need an AP, use a different
  * library.
@@ -26,6 +27,9 @@
 #include <Arduino.h>
 #include <SoftwareSerial.h>
 
+// Optional - see set_energy_meter().
+class LiteESP8266EnergyMeter;
+
 /**
  * Default software serial TX/RX pins.  This matches the SparkFun shield and
  * library, and happens to be what this library author uses as well for his
@@ -50,7 +54,29 @@
 #define WIFI_CONNECT_TIMEOUT 30000
 #define COMMAND_RESET_TIMEOUT 5000
 #define CLIENT_CONNECT_TIMEOUT 5000
+#define SSL_CONNECT_TIMEOUT 15000
 #define TEST_TIMEOUT 10000
+#define RADIO_READY_TIMEOUT 5000
+
+// How long power_on_radio() holds the enable pin low to restart a radio that
+// is already on.
+#define RADIO_RESTART_OFF_MS 10
+
+/**
+ * Milliseconds since start, a millis() reading.  All timeouts are checked as
+ * elapsed time, never as millis() against start + timeout: that sum wraps when
+ * millis() rolls over (every 49.7 days), and the wait ends at once or never.
+ * The subtraction is done in millis()'s 32 bits, so it comes out right across
+ * the rollover even where unsigned long is wider.
+ */
+#define LITE_ESP8266_ELAPSED_MS(start) ((uint32_t)(millis() - (start)))
+
+/**
+ * After waking from power down, how long the radio line must be quiet before
+ * the wake-up bytes are considered done (in ms).  This is also how long to
+ * wait for radio activity before deciding something else woke the MCU.
+ */
+#define WAKE_SETTLE_TIMEOUT 20
 
 /**
  * Response codes from various functions.
@@ -63,11 +89,19 @@
 #define LITE_ESP8266_TIMEOUT 2
 #define LITE_ESP8266_LENGTH_EXCEEDED 3
 
+// Byte reads return the byte, 0 to 255, or one of these.
+#define LITE_ESP8266_READ_TIMEOUT -1
+#define LITE_ESP8266_READ_CLOSED -2
+
 // Connection type defines, off in their own part of int space.
 #define LITE_ESP8266_TCP 100
 #define LITE_ESP8266_UDP 101
 #define LITE_ESP8266_SSL 102
 
+// The range AT+CIPSSLSIZE takes, in bytes (1.x firmware only).
+#define LITE_ESP8266_SSL_BUFFER_MIN 2048
+#define LITE_ESP8266_SSL_BUFFER_MAX 4096
+
 /**
  * This define and structure are used for storing and returning the radio
  * version strings.
@@ -88,6 +122,20 @@ typedef struct {
   char compile_time[VERSION_STRING_LENGTH];
 } esp8266_version_data;
 
+// Marks the enable pin as unused.
+#define LITE_ESP8266_NO_PIN 0xFF
+
+/**
+ * With multiple connections enabled (set_multiple_connections()), the radio
+ * has links 0 through LITE_ESP8266_MAX_LINKS - 1.  Without, there's a single
+ * unnumbered link, and LITE_ESP8266_NO_LINK is passed or returned instead.
+ */
+#define LITE_ESP8266_MAX_LINKS 5
+#define LITE_ESP8266_NO_LINK 0xFF
+
+// The most the radio takes in one send (AT+CIPSEND).
+#define LITE_ESP8266_MAX_SEND_LENGTH 2048
+
 // An IPv4 address requires a string of 16 bytes.
 // 255.255.255.255\0 (null terminator).
 #define IP_ADDRESS_LENGTH 16
@@ -118,6 +166,20 @@ public:
   bool begin(unsigned long baud_rate = 9600, byte tx_pin = ESP8266_SW_TX,
           byte rx_pin = ESP8266_SW_RX);
 
+  /**
+   * Initialize the class against an already configured Stream instead of the
+   * built-in SoftwareSerial port.  This lets you use a hardware serial port,
+   * or a fake transport (the host benchmarks in extras/ feed the parsers from
+   * in-memory streams this way).
+   *
+   * The stream is not owned by the class and must outlive it.  Calling the
+   * baud rate version of begin() afterwards switches back to SoftwareSerial.
+   *
+   * @param radio_stream The stream connected to the radio.
+   * @return True if the radio is initialized properly, otherwise false.
+   */
+  bool begin(Stream *radio_stream);
+
   /**
    * Sends an "AT\r\n" string to the radio and looks for an "OK\r\n" response.
    *
@@ -141,14 +203,67 @@ public:
 
   /**
    * Sends "AT+RST\r\n" to the radio, waits for an "OK" response.  This will
-   * reset the radio in much the same manner as a power cycle.  You should wait
-   * 5-10 seconds after calling this before expecting the radio to be online
-   * and responding to commands.
+   * reset the radio in much the same manner as a power cycle.  The radio is
+   * not usable until it has rebooted - call wait_for_ready() and then
+   * init_radio() rather than sleeping for a fixed 5-10 seconds.
    *
    * @return True if the radio responded OK.
    */
   bool reset_radio();
 
+  /**
+   * Wait for the "ready" banner the AT firmware prints once it has booted,
+   * after power up or a reset.
+   *
+   * Before the banner, the boot ROM prints its own messages at 74880 baud,
+   * which show up as garbage at any normal baud rate - this skips over it.
+   * Typically the banner comes well under a second after power up.
+   *
+   * Echo is back on after a reboot, so follow this with init_radio().
+   *
+   * @param timeout_ms The longest to wait for the banner.
+   * @return True if the radio is ready.
+   */
+  bool wait_for_ready(const unsigned int timeout_ms = RADIO_READY_TIMEOUT);
+
+  /**
+   * Set the pin wired to the radio's CH_PD (or EN) pin, which turns the radio
+   * fully on and off.  Off, the radio draws next to nothing - much less than
+   * deep sleep, and with no XPD_DCDC wiring needed.
+   *
+   * The pin is driven high (radio on) immediately, so call this before
+   * begin().  Until this is called, power_on_radio() and power_off_radio() do
+   * nothing.
+   *
+   * @param enable_pin The Arduino pin connected to CH_PD/EN.
+   */
+  void set_enable_pin(const byte enable_pin);
+
+  /**
+   * Power the radio up with the enable pin, wait for the "ready" banner and
+   * initialize it.  When this returns true the radio is ready for commands -
+   * no fixed delays needed.  A radio that is already on is turned off for a
+   * moment first, as the banner only comes at boot.
+   *
+   * The radio's settings stored in flash (_DEF commands: station mode, AP,
+   * baud) survive the power cycle; association with the AP restarts from
+   * scratch, so give the radio a few seconds before using the network, or
+   * call connect_to_ap() again.
+   *
+   * @param timeout_ms The longest to wait for the radio to boot.
+   * @return True if the radio booted and initialized, false on timeout, if
+   *   no enable pin is set, or if begin() hasn't been called.
+   */
+  bool power_on_radio(const unsigned int timeout_ms = RADIO_READY_TIMEOUT);
+
+  /**
+   * Cut power to the radio with the enable pin.  Any connection is dropped
+   * without notice - close it and disconnect from the AP first if you care.
+   *
+   * @return True if the radio was powered off, false if no enable pin is set.
+   */
+  bool power_off_radio();
+
   /**
    * Sends "AT+GMR\r\n" to the radio, parses the response into the caller-
    * allocated esp8266_version_data structure.
@@ -288,6 +403,21 @@ public:
    */
   bool get_local_ip(char *ip_address);
 
+  /**
+   * Enable or disable multiple connections - "AT+CIPMUX=1" to enable.
+   *
+   * With multiple connections, up to LITE_ESP8266_MAX_LINKS connections may be
+   * open at once, and every connect, send and close must name its link.  The
+   * radio refuses to change this while any connection is open.
+   *
+   * Received data is tagged with the link ("+IPD,<link>,<len>:") - use the
+   * link_id argument of get_response_packet() to find out which.
+   *
+   * @param multiple True for multiple connections, false for one.
+   * @return True if the radio accepted the change.
+   */
+  bool set_multiple_connections(const bool multiple);
+
   /**
    * Connect to a remote IP/port.  The remote host should be stored in program
    * memory as a string.
@@ -300,24 +430,60 @@ public:
    * @param progmem_host The remote host (IP or DNS name) in progmem.
    * @param port The remote port to connect to.
    * @param progmem_protocol The protocol to use.  Defaults to TCP.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
    * @return True if the connection is successful, false if it fails.
    */
   bool connect_progmem(const char *progmem_host,
           const unsigned int port,
-          const uint8_t protocol = LITE_ESP8266_TCP);
+          const uint8_t protocol = LITE_ESP8266_TCP,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
 
   // Same thing as above, but with the host stored in data memory.
   bool connect(const char *host,
           const unsigned int port,
-          const uint8_t protocol = LITE_ESP8266_TCP);
+          const uint8_t protocol = LITE_ESP8266_TCP,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Set the size of the radio's SSL buffer, before making an SSL connection.
+   * The radio's default (2048) can't hold the certificate chain some servers
+   * send, and the handshake fails; 4096 fits most, at the cost of the radio's
+   * own heap.  Needs the 1.x (NonOS SDK) AT firmware, with AT+CIPSSLSIZE -
+   * the ESP-AT 2.x builds size the buffer themselves, and answer ERROR.  The
+   * SSL timeout for connect() is SSL_CONNECT_TIMEOUT, to allow for the
+   * handshake.
+   *
+   * @param size The buffer size, LITE_ESP8266_SSL_BUFFER_MIN to
+   *   LITE_ESP8266_SSL_BUFFER_MAX bytes.
+   * @return True if the radio accepted it.
+   */
+  bool set_ssl_buffer_size(const unsigned int size);
+
+  /**
+   * Set the name sent with Server Name Indication in the next SSL connect -
+   * needed by servers hosting several sites on one address, which is most of
+   * the cloud.  Needs the ESP-AT 2.x firmware for the ESP8266, with
+   * AT+CIPSSLCSNI; the 1.x firmware has no SNI, and answers ERROR.  So this
+   * and set_ssl_buffer_size() never both work on one radio.
+   *
+   * @param progmem_host The server name, in program memory.
+   * @param link_id The link the next SSL connect will use with multiple
+   *   connections enabled, otherwise LITE_ESP8266_NO_LINK.
+   * @return True if the radio accepted it.
+   */
+  bool set_ssl_sni_progmem(const char *progmem_host,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
 
   /**
    * Close the connection if one is open.  You can call it all you want with
    * no open connection, but it's not going to do much...
    *
+   * @param link_id The link to close with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
    * @return True if the connection was closed, false if there was an error.
    */
-  bool close();
+  bool close(const uint8_t link_id = LITE_ESP8266_NO_LINK);
 
   /**
    * Send data through an open connection.
@@ -329,10 +495,38 @@ public:
    * The strings need to be properly null terminated.
    *
    * @param data The data to send, either in program memory or data memory.
+   * @param link_id The link to send on with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
    * @return True if the data is sent successfully.
    */
-  bool send(const char *data);
-  bool send_progmem(const char *data);
+  bool send(const char *data, const uint8_t link_id = LITE_ESP8266_NO_LINK);
+  bool send_progmem(const char *data,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Send data a byte at a time, for data that's never in memory as one string
+   * - generated as it goes, or read from somewhere else.
+   *
+   * begin_send() asks the radio for a send of exactly length bytes.  Then
+   * write() every byte, and call end_send() for the radio's answer.  The radio
+   * waits for all length bytes before sending anything, so write exactly that
+   * many: short, and it swallows the next command as data.
+   *
+   * @param length The number of bytes to follow, up to
+   *   LITE_ESP8266_MAX_SEND_LENGTH.
+   * @param link_id The link to send on with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @return True if the radio is ready for the data.
+   */
+  bool begin_send(const unsigned int length,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Finish a send started with begin_send().
+   *
+   * @return True if the radio reports the data sent.
+   */
+  bool end_send();
 
   /**
    * Get a response packet.  This is from the "+IPD,<len>:" on - so includes all
@@ -360,13 +554,17 @@ public:
    * @param max_allocate_bytes The maximum allowed number of bytes to allocate
    *   for the response.
    * @param timeout_ms The time to wait for the full response packet.
+   * @param link_id If not NULL, set to the link the packet arrived on with
+   *   multiple connections enabled, otherwise LITE_ESP8266_NO_LINK.
    * @return A character buffer, filled with either the full packet, as much as
    *   could be read before the timeout, or max_allocate_bytes - 1 characters,
    *   null terminated.  THE CALLER MUST FREE THIS BUFFER.
-   *   If something has gone wrong, the return is NULL - check this!
+   *   If something has gone wrong, or there isn't the memory for it, the
+   *   return is NULL - check this!
    */
   char *get_response_packet(const unsigned int max_allocate_bytes,
-          const unsigned int timeout_ms = CLIENT_CONNECT_TIMEOUT);
+          const unsigned int timeout_ms = CLIENT_CONNECT_TIMEOUT,
+          uint8_t *link_id = NULL);
 
   /**
    * Same as above, but works with HTTP response headers, and only returns
@@ -394,11 +592,143 @@ public:
    * @return A character buffer, filled with either the data after headers, as
    *   much as could be read before the timeout, or max_allocate_bytes - 1
    *   characters, null terminated.  THE CALLER MUST FREE THIS BUFFER.
-   *   If something has gone wrong, the return is NULL - check this!
+   *   If something has gone wrong, or there isn't the memory for it, the
+   *   return is NULL - check this!
    */
   char *get_http_response(const unsigned int max_allocate_bytes,
           const unsigned int timeout_ms = CLIENT_CONNECT_TIMEOUT);
 
+  /**
+   * Read received data a byte at a time, straight from the "+IPD" packets, for
+   * streams that are handled as they arrive rather than buffered whole.
+   *
+   * remaining is the caller's count of bytes left in the current packet:
+   * start it at 0, and pass the same one back every call.  When it's 0, the
+   * next packet header is read first, skipping anything that isn't one - or
+   * noticing that a connection has closed.  Active receive mode only.
+   *
+   * unsigned int remaining = 0;
+   * int c;
+   * while ((c = radio.read_packet_byte(&remaining, 1000)) >= 0) {
+   *   // Do something with (char)c.
+   * }
+   *
+   * @param remaining Bytes left in the current packet.
+   * @param timeout_ms How long to wait for the byte.
+   * @param link_id If not NULL, set to the link of each new packet with
+   *   multiple connections enabled, otherwise LITE_ESP8266_NO_LINK.
+   * @return The byte, 0 to 255, or LITE_ESP8266_READ_TIMEOUT, or
+   *   LITE_ESP8266_READ_CLOSED if a connection closed between packets.
+   */
+  int read_packet_byte(unsigned int *remaining, const unsigned int timeout_ms,
+          uint8_t *link_id = NULL);
+
+
+  // ===========================================================================
+  // Passive receive and low power waiting
+  // ===========================================================================
+
+  /**
+   * Switch the radio between active and passive receive modes - 
+   * "AT+CIPRECVMODE=1" for passive.  This needs AT firmware 1.7 or newer.
+   *
+   * In the default active mode, the radio pushes received data out as soon as
+   * it arrives ("+IPD,<len>:<data>"), and anything the MCU misses is gone.  In
+   * passive mode the radio holds the data and only sends a short notice
+   * ("+IPD,<len>\r\n").  The data is then fetched when the MCU is ready with
+   * get_passive_receive_length() and read_passive_data().
+   *
+   * Passive mode is what makes sleeping until data arrives safe - the notice
+   * may be garbled by the wake up, but the data itself is not.  Note that
+   * get_response_packet() and get_http_response() only work in active mode.
+   *
+   * @param passive True for passive mode, false for active mode.
+   * @return True if the radio accepted the mode.
+   */
+  bool set_passive_receive(const bool passive);
+
+  /**
+   * In passive mode, ask the radio how many received bytes it is holding -
+   * "AT+CIPRECVLEN?".  The radio answers for every link, with multiple
+   * connections or without, and link_id picks one.
+   *
+   * @param length Set to the number of bytes waiting.
+   * @param link_id The link with multiple connections enabled, otherwise
+   *   LITE_ESP8266_NO_LINK.
+   * @return True if the radio answered.
+   */
+  bool get_passive_receive_length(unsigned int *length,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * In passive mode, fetch up to buffer_size bytes of held data -
+   * "AT+CIPRECVDATA=<len>", or "AT+CIPRECVDATA=<link>,<len>".
+   *
+   * This is binary safe: the buffer is filled with exactly the bytes received
+   * and is NOT null terminated.  Leave room and terminate it yourself if you
+   * want a string.  Data the radio doesn't send now stays on the radio for the
+   * next call.
+   *
+   * @param buffer Caller allocated buffer of at least buffer_size bytes.
+   * @param buffer_size The most bytes to fetch.
+   * @param timeout_ms The time to wait for the data.
+   * @param link_id The link with multiple connections enabled, otherwise
+   *   LITE_ESP8266_NO_LINK.
+   * @return The number of bytes placed in buffer - 0 if there was no data or
+   *   something went wrong.
+   */
+  unsigned int read_passive_data(char *buffer, const unsigned int buffer_size,
+          const unsigned int timeout_ms = COMMAND_RESPONSE_TIMEOUT,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Put the MCU in power down (SLEEP_MODE_PWR_DOWN) until the radio sends
+   * something.  AVR with the built-in SoftwareSerial port only.
+   *
+   * SoftwareSerial already drives its receive pin with a pin change
+   * interrupt, and pin change interrupts wake the AVR from power down - so
+   * this makes sure the port is listening (which arms the interrupt), and
+   * sleeps.  Power down draws microamps instead of the milliamps of idle.
+   *
+   * The catch: the oscillator takes about 1ms to start after waking, so the
+   * first byte or two from the radio are garbage.  This function discards
+   * them, waiting until the line has been quiet for WAKE_SETTLE_TIMEOUT ms.
+   * Use passive receive mode (above) so that what gets lost is only the
+   * "+IPD" notice and not the data, then fetch the data with
+   * read_passive_data().  In active mode, only use this with protocols that
+   * tolerate the first message being lost (the server repeats until it gets
+   * an acknowledgment, for example).
+   *
+   * Other enabled interrupts (external, other pin changes, the watchdog) also
+   * wake the MCU.  If nothing comes from the radio within WAKE_SETTLE_TIMEOUT
+   * ms of waking, this returns false so the caller can handle the other source
+   * and sleep again.
+   *
+   * millis() does not advance while powered down.
+   *
+   * @return True if the radio woke the MCU, false if something else did, or
+   *   if sleeping isn't supported (not AVR, or begin() was given a Stream).
+   */
+  bool sleep_until_radio_data();
+
+
+  // ===========================================================================
+  // Energy accounting
+  // ===========================================================================
+
+  /**
+   * Attach an energy meter (LiteESP8266Energy.h).  The radio reports its state
+   * to the meter as commands go by - receiver on while joining, resolving,
+   * connecting and waiting for responses, transmitter on while sending, off or
+   * deep sleeping when told to be - and the meter turns that into time and
+   * charge per state.
+   *
+   * The meter is not owned by the class and must outlive it.  Pass NULL to
+   * detach.  With no meter attached this costs a pointer check per command.
+   *
+   * @param energy_meter The meter to report to, or NULL.
+   */
+  void set_energy_meter(LiteESP8266EnergyMeter *energy_meter);
 
   /**
    * These functions are available to calling code to enable adding new
@@ -410,12 +740,67 @@ public:
   char read();
   void write(const char c);
 
+  /**
+   * Write a string to the radio, for modules that build a send a piece at a
+   * time with begin_send().  Only the characters go, not the null.
+   *
+   * @param string The string, in data memory or program memory.
+   */
+  void write_string(const char *string);
+  void write_progmem(const char *progmem_string);
+
+  /**
+   * The number of decimal digits in a number, for working out the length of
+   * a send before writing it.
+   *
+   * @param value The number.
+   * @return The digits it prints as - 1 for 0.
+   */
+  static uint8_t digit_count(unsigned long value);
+
 protected:
-  // Pointer to the SoftwareSerial object used to talk to the radio.
-  // Should be about 4 bytes of SRAM.
-  SoftwareSerial* radio_serial_;
+  // Pointer to the stream used to talk to the radio.  This is normally the
+  // SoftwareSerial port below, but may be any Stream passed to begin().
+  Stream* radio_serial_;
+
+  // The SoftwareSerial object owned by this class, if one has been created.
+  // Together with the above, about 4 bytes of SRAM.
+  SoftwareSerial* software_serial_;
+
+  // Pin driving the radio's CH_PD/EN, or LITE_ESP8266_NO_PIN.
+  byte enable_pin_;
+
+  // Energy meter to report state changes to, or NULL.
+  LiteESP8266EnergyMeter* energy_meter_;
+
+  /**
+   * Tell the energy meter, if there is one, what the radio is doing now.
+   *
+   * @param state One of the LITE_ESP8266_STATE_ values.
+   */
+  void set_radio_state(const uint8_t state);
+
+  /**
+   * Write "<link_id>," to buffer, null terminated, or just the terminator for
+   * LITE_ESP8266_NO_LINK.  Commands with a link take it as the first argument.
+   *
+   * @param buffer At least 3 bytes.
+   * @param link_id The link, or LITE_ESP8266_NO_LINK.
+   */
+  void link_id_prefix(char *buffer, const uint8_t link_id);
+
+  /**
+   * Read the rest of a packet header, after the "+IPD,": "<len>:" or, with
+   * multiple connections, "<link>,<len>:".
+   *
+   * @param link_id If not NULL, set to the link, or LITE_ESP8266_NO_LINK.
+   * @return The length of the data that follows.
+   */
+  unsigned int read_packet_header(uint8_t *link_id);
+
+  // The command and parsing helpers below are protected so that derived
+  // classes (and the host benchmarks) can drive them directly.
 
-private:
   /**
    * Disables command echo - "ATE0\r\n"
    * 
@@ -0,0 +1,77 @@
+/**
+ * AT command and response strings used by the LiteESP8266 class, stored in
+ * program memory.
+ *
+ * These live in their own header so tools that need to decode the AT
+ * conversation (the wire capture analyzer in extras/) work from exactly the
+ * strings the library sends and matches.  The arrays have internal linkage, so
+ * each translation unit including this gets its own copy - only include it
+ * where the strings are actually used.
+ */
+
+#ifndef _LITEESP8266COMMANDS_H_
+#define _LITEESP8266COMMANDS_H_
+
+#include <Arduino.h>
+
+// AT test commands and prefix.
+const char ESP8266_TEST[] PROGMEM = "AT";  // Test AT startup
+const char ESP8266_COMMAND_PREFIX[] PROGMEM = "AT+";
+const char ESP8266_COMMAND_DISABLE_ECHO[] PROGMEM = "ATE0";
+
+// AT commands.  ? or = is included after them if needed, and optionally the
+// fixed parameters.
+const char ESP8266_COMMAND_RESET[] PROGMEM = "RST";
+const char ESP8266_COMMAND_VERSION[] PROGMEM = "GMR";
+const char ESP8266_COMMAND_DEEP_SLEEP[] PROGMEM = "GSLP=";
+const char ESP8266_COMMAND_SET_BAUD[] PROGMEM = "UART_DEF=";
+const char ESP8266_COMMAND_SET_RFPOWER[] PROGMEM = "RFPOWER=";
+const char ESP8266_COMMAND_SET_STATION_MODE[] PROGMEM = "CWMODE_DEF=1";
+const char ESP8266_COMMAND_ENABLE_STATION_DHCP[] PROGMEM = "CWDHCP_DEF=1,1";
+const char ESP8266_COMMAND_CONNECT_TO_AP[] PROGMEM = "CWJAP_DEF=";
+const char ESP8266_COMMAND_DISCONNET_FROM_AP[] PROGMEM = "CWQAP";
+const char ESP8266_COMMAND_DNS_LOOKUP[] PROGMEM = "CIPDOMAIN=";
+const char ESP8266_COMMAND_GET_LOCAL_IP[] PROGMEM = "CIFSR";
+const char ESP8266_COMMAND_MULTIPLE_CONNECTIONS[] PROGMEM = "CIPMUX=";
+const char ESP8266_COMMAND_CONNECT[] PROGMEM = "CIPSTART=";
+const char ESP8266_COMMAND_CLOSE_CONNECTION[] PROGMEM = "CIPCLOSE";
+const char ESP8266_COMMAND_CLOSE_LINK[] PROGMEM = "CIPCLOSE=";
+const char ESP8266_COMMAND_SEND_DATA[] PROGMEM = "CIPSEND=";
+const char ESP8266_COMMAND_RECEIVE_MODE[] PROGMEM = "CIPRECVMODE=";
+const char ESP8266_COMMAND_RECEIVE_LENGTH[] PROGMEM = "CIPRECVLEN?";
+const char ESP8266_COMMAND_RECEIVE_DATA[] PROGMEM = "CIPRECVDATA=";
+const char ESP8266_COMMAND_SSL_BUFFER_SIZE[] PROGMEM = "CIPSSLSIZE=";
+const char ESP8266_COMMAND_SSL_SNI[] PROGMEM = "CIPSSLCSNI=";
+
+// Commands are terminated with CRLF.
+const char CRLF[] PROGMEM = "\r\n";
+
+// Serial options beyond baud.  8,N,1 with no flow control is sane.
+const char ESP8266_SERIAL_OPTIONS[] PROGMEM = ",8,1,0,0";
+
+// Assorted responses one might look for.
+const char ESP8266_RESPONSE_OK[] PROGMEM = "OK\r\n";
+const char ESP8266_RESPONSE_ERROR[] PROGMEM = "ERROR\r\n";
+const char ESP8266_RESPONSE_FAIL[] PROGMEM = "FAIL\r\n";
+const char ESP8266_RESPONSE_READY[] PROGMEM = "ready\r\n";
+const char ESP8266_RESPONSE_CLOSED[] PROGMEM = "CLOSED\r\n";
+const char ESP8266_DNS_LOOKUP_PREFIX[] PROGMEM = "+CIPDOMAIN:";
+const char ESP8266_LOCAL_IP_ADDRESS[] PROGMEM = ":STAIP,";
+const char ESP8266_SEND_OK[] PROGMEM = "SEND OK\r\n";
+const char ESP8266_DATA_PACKET[] PROGMEM = "+IPD,";
+const char ESP8266_CONTENT_LENGTH_HEADER[] PROGMEM = "Content-Length: ";
+const char ESP8266_RECEIVE_LENGTH_PREFIX[] PROGMEM = "+CIPRECVLEN:";
+const char ESP8266_RECEIVE_DATA_PREFIX[] PROGMEM = "+CIPRECVDATA,";
+
+// Terminates HTTP header section, opens content section.
+const char ESP8266_CRLFCRLF[] PROGMEM = "\r\n\r\n";
+
+// Connection types - with quotes and commas!
+const char ESP8266_TCP[] PROGMEM = "\"TCP\",";
+const char ESP8266_UDP[] PROGMEM = "\"UDP\",";
+const char ESP8266_SSL[] PROGMEM = "\"SSL\",";
+
+// Set to the maximum command length (above), with terminating null.
+#define MAX_COMMAND_LENGTH 16
+
+#endif // _LITEESP8266COMMANDS_H_
@@ -0,0 +1,280 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266Download.h"
+
+// Request pieces.
+const char DOWNLOAD_GET[] PROGMEM = "GET ";
+const char DOWNLOAD_HOST[] PROGMEM = " HTTP/1.1\r\nHost: ";
+const char DOWNLOAD_RANGE[] PROGMEM = "\r\nRange: bytes=";
+const char DOWNLOAD_KEEP_ALIVE[] PROGMEM =
+    "\r\nConnection: keep-alive\r\n\r\n";
+
+// Response headers of interest.
+const char DOWNLOAD_HTTP[] PROGMEM = "HTTP/";
+const char DOWNLOAD_CONTENT_RANGE[] PROGMEM = "Content-Range: bytes ";
+const char DOWNLOAD_CONTENT_LENGTH[] PROGMEM = "Content-Length: ";
+
+#define HTTP_OK 200
+#define HTTP_PARTIAL_CONTENT 206
+#define HTTP_RANGE_NOT_SATISFIABLE 416
+
+LiteESP8266RangeDownload::LiteESP8266RangeDownload() {
+  radio_ = NULL;
+  total_length_ = LITE_ESP8266_UNKNOWN_LENGTH;
+  bytes_delivered_ = 0;
+  connected_ = 0;
+}
+
+uint8_t LiteESP8266RangeDownload::download(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const char *progmem_path, const uint8_t links,
+        const unsigned int range_size, char *buffer,
+        const unsigned int buffer_size, esp8266_download_sink sink,
+        void *context, const unsigned int timeout_ms) {
+  uint8_t result = LITE_ESP8266_SUCCESS;
+  unsigned long range = 0, next_request = 0;
+
+  radio_ = radio;
+  host_ = progmem_host;
+  path_ = progmem_path;
+  port_ = port;
+  links_ = links;
+  if (links_ < 1) {
+    links_ = 1;
+  }
+  if (links_ > LITE_ESP8266_MAX_LINKS) {
+    links_ = LITE_ESP8266_MAX_LINKS;
+  }
+  range_size_ = range_size;
+  buffer_ = buffer;
+  buffer_size_ = buffer_size;
+  sink_ = sink;
+  context_ = context;
+  timeout_ms_ = timeout_ms;
+  total_length_ = LITE_ESP8266_UNKNOWN_LENGTH;
+  bytes_delivered_ = 0;
+  connected_ = 0;
+
+  if (!radio_->set_passive_receive(true)) {
+    return LITE_ESP8266_FAILURE;
+  }
+
+  // Get a request going on every link.  The length isn't known yet, so some
+  // of these may be past the end - they come back 416 and are ignored.
+  for (; next_request < links_ && result == LITE_ESP8266_SUCCESS;
+          next_request++) {
+    result = request_range(next_request);
+  }
+
+  // Read the ranges in order.  Each link, when done, asks for the next range
+  // it's due, and that round trip overlaps reading the other links.
+  while (result == LITE_ESP8266_SUCCESS &&
+          range * range_size_ < total_length_) {
+    result = read_range(range);
+    if (result != LITE_ESP8266_SUCCESS) {
+      break;
+    }
+
+    // No Range support - the first response was the whole thing.
+    if (status_ == HTTP_OK) {
+      break;
+    }
+
+    range++;
+    if (next_request * range_size_ < total_length_) {
+      result = request_range(next_request++);
+    }
+  }
+
+  // Drop the connections, and anything left on them.
+  for (uint8_t link = 0; link < links_; link++) {
+    if (connected_ & (1 << link)) {
+      radio_->close(link_for(link));
+    }
+  }
+  connected_ = 0;
+
+  radio_->set_passive_receive(false);
+  return result;
+}
+
+uint8_t LiteESP8266RangeDownload::link_for(const unsigned long range) {
+  return (links_ > 1) ? (range % links_) : LITE_ESP8266_NO_LINK;
+}
+
+uint8_t LiteESP8266RangeDownload::request_range(const unsigned long range) {
+  uint8_t link = link_for(range);
+  uint8_t link_bit = 1 << (range % links_);
+  unsigned long first = range * range_size_;
+  // Two 10 digit numbers, the dash, and the null.
+  unsigned int request_length = strlen_P(DOWNLOAD_GET) + strlen_P(path_) +
+      strlen_P(DOWNLOAD_HOST) + strlen_P(host_) + strlen_P(DOWNLOAD_RANGE) +
+      strlen_P(DOWNLOAD_KEEP_ALIVE) + 22;
+
+  if (request_length > buffer_size_) {
+    return LITE_ESP8266_LENGTH_EXCEEDED;
+  }
+
+  // The buffer isn't holding anything between reads - build the request
+  // there, so it goes out in one send.
+  strcpy_P(buffer_, DOWNLOAD_GET);
+  strcat_P(buffer_, path_);
+  strcat_P(buffer_, DOWNLOAD_HOST);
+  strcat_P(buffer_, host_);
+  strcat_P(buffer_, DOWNLOAD_RANGE);
+  ultoa(first, buffer_ + strlen(buffer_), 10);
+  strcat(buffer_, "-");
+  ultoa(first + range_size_ - 1, buffer_ + strlen(buffer_), 10);
+  strcat_P(buffer_, DOWNLOAD_KEEP_ALIVE);
+
+  if ((connected_ & link_bit) && radio_->send(buffer_, link)) {
+    return LITE_ESP8266_SUCCESS;
+  }
+
+  // Not connected, or the server closed the connection since - (re)connect.
+  connected_ &= ~link_bit;
+  if (!radio_->connect_progmem(host_, port_, LITE_ESP8266_TCP, link)) {
+    return LITE_ESP8266_FAILURE;
+  }
+  connected_ |= link_bit;
+  return radio_->send(buffer_, link) ? LITE_ESP8266_SUCCESS :
+      LITE_ESP8266_FAILURE;
+}
+
+uint8_t LiteESP8266RangeDownload::read_range(const unsigned long range) {
+  uint8_t link = link_for(range);
+  unsigned long last_data = millis();
+  unsigned int bytes_read, offset, deliver;
+
+  status_ = 0;
+  in_body_ = false;
+  got_range_ = false;
+  line_length_ = 0;
+  range_start_ = 0;
+  body_remaining_ = 0;
+  content_length_ = LITE_ESP8266_UNKNOWN_LENGTH;
+
+  while (true) {
+    bytes_read = radio_->read_passive_data(buffer_, buffer_size_, timeout_ms_,
+            link);
+
+    if (!bytes_read) {
+      if (LITE_ESP8266_ELAPSED_MS(last_data) > timeout_ms_) {
+        return LITE_ESP8266_TIMEOUT;
+      }
+      // Nothing held for this link yet.  Rather than ask over and over, wait
+      // for the radio to say something (an "+IPD" notice, most likely).
+      unsigned long wait_start = millis();
+      while (!radio_->available() &&
+              LITE_ESP8266_ELAPSED_MS(wait_start) < DOWNLOAD_POLL_TIMEOUT);
+      continue;
+    }
+    last_data = millis();
+
+    for (offset = 0; offset < bytes_read && !in_body_; offset++) {
+      char c = buffer_[offset];
+      if (c == '\n') {
+        line_[line_length_] = 0;
+        if (line_length_ == 0 || (line_length_ == 1 && line_[0] == '\r')) {
+          // Blank line - the headers are done.
+          uint8_t result = check_headers(range);
+          if (result != LITE_ESP8266_SUCCESS) {
+            return result;
+          }
+          in_body_ = true;
+        } else {
+          parse_header_line();
+        }
+        line_length_ = 0;
+      } else if (line_length_ < DOWNLOAD_HEADER_LINE_LENGTH - 1) {
+        line_[line_length_++] = c;
+      }
+    }
+
+    if (in_body_) {
+      deliver = bytes_read - offset;
+      if (deliver > body_remaining_) {
+        deliver = body_remaining_;
+      }
+      // Only ranges that are part of the file get passed on.
+      if (deliver && status_ != HTTP_RANGE_NOT_SATISFIABLE) {
+        if (!sink_(buffer_ + offset, deliver, context_)) {
+          return LITE_ESP8266_FAILURE;
+        }
+        bytes_delivered_ += deliver;
+      }
+      body_remaining_ -= deliver;
+      if (!body_remaining_) {
+        return LITE_ESP8266_SUCCESS;
+      }
+    }
+  }
+}
+
+/**
+ * Lines look like:
+ * HTTP/1.1 206 Partial Content
+ * Content-Range: bytes 4096-8191/65536
+ * Content-Length: 4096
+ * And for a range past the end:
+ * Content-Range: bytes * /65536 (without the space)
+ */
+void LiteESP8266RangeDownload::parse_header_line() {
+  char *field;
+
+  if (!strncmp_P(line_, DOWNLOAD_HTTP, strlen_P(DOWNLOAD_HTTP))) {
+    field = strchr(line_, ' ');
+    if (field) {
+      status_ = atoi(field + 1);
+    }
+  } else if (!strncasecmp_P(line_, DOWNLOAD_CONTENT_RANGE,
+          strlen_P(DOWNLOAD_CONTENT_RANGE))) {
+    field = line_ + strlen_P(DOWNLOAD_CONTENT_RANGE);
+    if (*field != '*') {
+      range_start_ = strtoul(field, &field, 10);
+      if (*field == '-') {
+        body_remaining_ = strtoul(field + 1, &field, 10) - range_start_ + 1;
+        got_range_ = true;
+      }
+    }
+    field = strchr(field, '/');
+    if (field && field[1] != '*') {
+      total_length_ = strtoul(field + 1, NULL, 10);
+    }
+  } else if (!strncasecmp_P(line_, DOWNLOAD_CONTENT_LENGTH,
+          strlen_P(DOWNLOAD_CONTENT_LENGTH))) {
+    content_length_ = strtoul(line_ + strlen_P(DOWNLOAD_CONTENT_LENGTH), NULL,
+            10);
+  }
+}
+
+uint8_t LiteESP8266RangeDownload::check_headers(const unsigned long range) {
+  switch (status_) {
+    case HTTP_PARTIAL_CONTENT:
+      // Must be the range asked for.
+      if (!got_range_ || range_start_ != range * range_size_) {
+        return LITE_ESP8266_FAILURE;
+      }
+      return LITE_ESP8266_SUCCESS;
+
+    case HTTP_OK:
+      // The whole file.  Only believable as the first response.
+      if (range != 0 || content_length_ == LITE_ESP8266_UNKNOWN_LENGTH) {
+        return LITE_ESP8266_FAILURE;
+      }
+      total_length_ = content_length_;
+      body_remaining_ = content_length_;
+      return LITE_ESP8266_SUCCESS;
+
+    case HTTP_RANGE_NOT_SATISFIABLE:
+      // Past the end - total_length_ came from the Content-Range.  Skip any
+      // body the server sent along.
+      body_remaining_ = (content_length_ == LITE_ESP8266_UNKNOWN_LENGTH) ?
+          0 : content_length_;
+      return LITE_ESP8266_SUCCESS;
+
+    default:
+      return LITE_ESP8266_FAILURE;
+  }
+}
@@ -0,0 +1,155 @@
+/**
+ * Parallel range downloads over several links.
+ *
+ * Fetching a large file over one connection from a distant server spends most
+ * of the time waiting on round trips, with the UART idle.  This splits the
+ * file into fixed size byte ranges ("Range: bytes=a-b") and keeps a request
+ * outstanding on each of 2 or 3 links, so that while one range is being read,
+ * the next ones are already on their way.
+ *
+ * The reorder window is the radio's own buffer.  The radio runs in passive
+ * receive mode during the download: each link's data is held on the radio
+ * until asked for, so ranges are read strictly in order, straight into the
+ * sink, and the MCU never holds more than one buffer.  A link that finishes
+ * its range immediately asks for the next one it's due (range n goes on link
+ * n % links), over a kept-alive connection.
+ *
+ * Servers that ignore Range and answer "200 OK" with the whole file still
+ * work - the first response is used and the other links are dropped.
+ *
+ * bool write_to_sd(const char *data, const unsigned int length,
+ *         void *context) {
+ *   return ((File *)context)->write((const uint8_t *)data, length) == length;
+ * }
+ *
+ * char buffer[192];
+ * LiteESP8266RangeDownload download;
+ * radio.set_multiple_connections(true);
+ * download.download(&radio, host, 80, path, 3, 4096, buffer, sizeof(buffer),
+ *         write_to_sd, &file);
+ *
+ * Needs AT firmware 1.7 or newer for passive receive.  The object uses about
+ * 100 bytes of SRAM while it exists - make it a local, and it's only for the
+ * duration of the download.
+ */
+
+#ifndef _LITEESP8266DOWNLOAD_H_
+#define _LITEESP8266DOWNLOAD_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+// If nothing is held for the link being read, how long to watch for the
+// radio's "+IPD" notice before asking again.
+#define DOWNLOAD_POLL_TIMEOUT 100
+
+// Response header lines are parsed from a buffer this size.  Longer lines are
+// truncated, which is fine for the headers that matter.
+#define DOWNLOAD_HEADER_LINE_LENGTH 56
+
+// Length not known (yet).
+#define LITE_ESP8266_UNKNOWN_LENGTH 0xFFFFFFFFUL
+
+/**
+ * Receives the downloaded data, in order.
+ *
+ * @param data The next bytes of the file.  Not null terminated.
+ * @param length How many bytes.
+ * @param context The context passed to download().
+ * @return True to carry on, false to abort the download.
+ */
+typedef bool (*esp8266_download_sink)(const char *data,
+        const unsigned int length, void *context);
+
+class LiteESP8266RangeDownload {
+public:
+  LiteESP8266RangeDownload();
+
+  /**
+   * Download a file, calling sink with the data in order.
+   *
+   * With links greater than 1, multiple connections must already be enabled
+   * (set_multiple_connections()), and links 0 through links - 1 must be free.
+   * With 1 link this is a plain sequential range download.  The radio is put
+   * in passive receive mode for the download, and back in active mode after.
+   *
+   * The buffer holds each read from the radio, and also each request as it's
+   * built, so it must fit "GET <path> HTTP/1.1", the Host header and the
+   * Range header - about 80 bytes plus the path and host.  Bigger buffers
+   * mean fewer reads: each costs about 40 bytes of AT overhead on the UART.
+   *
+   * @param radio The radio.
+   * @param progmem_host The server (IP or DNS name), in program memory.
+   * @param port The server port.
+   * @param progmem_path The path to fetch, in program memory.
+   * @param links How many links to use, 1 to LITE_ESP8266_MAX_LINKS.
+   * @param range_size Bytes per range request.  A few KB is about right: big
+   *   enough to amortize the request, small enough that the radio can hold
+   *   one per link.
+   * @param buffer Caller allocated working buffer.
+   * @param buffer_size The size of buffer.
+   * @param sink Called with the data, in order.
+   * @param context Passed to sink.
+   * @param timeout_ms The longest to wait for data on a link.
+   * @return LITE_ESP8266_SUCCESS, LITE_ESP8266_TIMEOUT if a link went quiet,
+   *   LITE_ESP8266_LENGTH_EXCEEDED if the request doesn't fit the buffer, or
+   *   LITE_ESP8266_FAILURE for anything else (including the sink aborting).
+   */
+  uint8_t download(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port, const char *progmem_path,
+          const uint8_t links, const unsigned int range_size, char *buffer,
+          const unsigned int buffer_size, esp8266_download_sink sink,
+          void *context, const unsigned int timeout_ms = CLIENT_CONNECT_TIMEOUT);
+
+  // The file length, once the first response is in, or
+  // LITE_ESP8266_UNKNOWN_LENGTH.
+  unsigned long total_length() { return total_length_; }
+
+  // Bytes passed to the sink so far.
+  unsigned long bytes_delivered() { return bytes_delivered_; }
+
+private:
+  // Send the request for a range on its link, connecting if need be.
+  uint8_t request_range(const unsigned long range);
+
+  // Read the response to a range, passing the body to the sink.
+  uint8_t read_range(const unsigned long range);
+
+  // Act on a complete header line in line_.
+  void parse_header_line();
+
+  // Check the headers once they're all in.
+  uint8_t check_headers(const unsigned long range);
+
+  uint8_t link_for(const unsigned long range);
+
+  LiteESP8266 *radio_;
+  const char *host_;
+  const char *path_;
+  char *buffer_;
+  esp8266_download_sink sink_;
+  void *context_;
+  unsigned long total_length_;
+  unsigned long bytes_delivered_;
+  unsigned int port_;
+  unsigned int range_size_;
+  unsigned int buffer_size_;
+  unsigned int timeout_ms_;
+  uint8_t links_;
+
+  // Bit n set: the connection for link n is (as far as we know) open.
+  uint8_t connected_;
+
+  // The response being read.
+  unsigned long range_start_;
+  unsigned long body_remaining_;
+  unsigned long content_length_;
+  unsigned int status_;
+  char line_[DOWNLOAD_HEADER_LINE_LENGTH];
+  uint8_t line_length_;
+  bool in_body_;
+  bool got_range_;
+};
+
+#endif // _LITEESP8266DOWNLOAD_H_
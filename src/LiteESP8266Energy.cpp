@@ -0,0 +1,97 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266Energy.h"
+
+LiteESP8266EnergyMeter::LiteESP8266EnergyMeter() {
+  state_current_ua_[LITE_ESP8266_STATE_OFF] = LITE_ESP8266_CURRENT_OFF_UA;
+  state_current_ua_[LITE_ESP8266_STATE_DEEP_SLEEP] =
+      LITE_ESP8266_CURRENT_DEEP_SLEEP_UA;
+  state_current_ua_[LITE_ESP8266_STATE_IDLE] = LITE_ESP8266_CURRENT_IDLE_UA;
+  state_current_ua_[LITE_ESP8266_STATE_TX] = LITE_ESP8266_CURRENT_TX_UA;
+  state_current_ua_[LITE_ESP8266_STATE_RX_WAIT] =
+      LITE_ESP8266_CURRENT_RX_WAIT_UA;
+
+  // Assume the radio is on until told otherwise.
+  state_ = LITE_ESP8266_STATE_IDLE;
+  start_cycle();
+}
+
+void LiteESP8266EnergyMeter::set_state_current(const uint8_t state,
+        const unsigned long current_ua) {
+  if (state < LITE_ESP8266_STATE_COUNT) {
+    // Charge up to now at the old current.
+    accumulate();
+    state_current_ua_[state] = current_ua;
+  }
+}
+
+void LiteESP8266EnergyMeter::set_state(const uint8_t state) {
+  if (state < LITE_ESP8266_STATE_COUNT && state != state_) {
+    accumulate();
+    state_ = state;
+  }
+}
+
+void LiteESP8266EnergyMeter::add_time_ms(const unsigned long time_ms) {
+  accumulate();
+  add_charge(time_ms);
+}
+
+void LiteESP8266EnergyMeter::start_cycle() {
+  memset(state_time_ms_, 0, sizeof(state_time_ms_));
+  charge_uc_ = 0;
+  operation_start_uc_ = 0;
+  remainder_ua_ms_ = 0;
+  last_update_ms_ = millis();
+}
+
+unsigned long LiteESP8266EnergyMeter::time_in_state_ms(const uint8_t state) {
+  if (state >= LITE_ESP8266_STATE_COUNT) {
+    return 0;
+  }
+  accumulate();
+  return state_time_ms_[state];
+}
+
+unsigned long LiteESP8266EnergyMeter::charge_uc() {
+  accumulate();
+  return charge_uc_;
+}
+
+// 1mAh is 3.6 coulombs.
+float LiteESP8266EnergyMeter::charge_mah() {
+  return charge_uc() / 3600000.0;
+}
+
+void LiteESP8266EnergyMeter::begin_operation() {
+  operation_start_uc_ = charge_uc();
+}
+
+unsigned long LiteESP8266EnergyMeter::operation_charge_uc() {
+  return charge_uc() - operation_start_uc_;
+}
+
+void LiteESP8266EnergyMeter::accumulate() {
+  unsigned long now = millis();
+
+  // Unsigned subtraction, in millis()'s 32 bits, handles it rolling over.
+  add_charge((uint32_t)(now - last_update_ms_));
+  last_update_ms_ = now;
+}
+
+void LiteESP8266EnergyMeter::add_charge(const unsigned long time_ms) {
+  unsigned long current_ua = state_current_ua_[state_];
+
+  state_time_ms_[state_] += time_ms;
+
+  /**
+   * microamps * milliseconds overflows 32 bits after 25 seconds at 170mA, so
+   * do whole seconds and the leftover milliseconds separately.  The leftover
+   * is at most 999ms * 4.29A before overflowing, which is plenty.
+   */
+  charge_uc_ += (time_ms / 1000) * current_ua;
+  remainder_ua_ms_ += (time_ms % 1000) * current_ua;
+  charge_uc_ += remainder_ua_ms_ / 1000;
+  remainder_ua_ms_ %= 1000;
+}
@@ -0,0 +1,139 @@
+/**
+ * Energy accounting for the LiteESP8266 radio.
+ *
+ * The radio's current draw depends almost entirely on what it's doing, and
+ * the library knows what it's doing from the commands it sends: joining an AP
+ * or waiting for a response means the receiver is on, sending data means the
+ * transmitter is on, and so on.  Attach a LiteESP8266EnergyMeter to the radio
+ * and it tracks the time spent in each state, and - given the current drawn
+ * in each state - the charge used.
+ *
+ * LiteESP8266 radio;
+ * LiteESP8266EnergyMeter meter;
+ *
+ * radio.set_energy_meter(&meter);
+ * meter.start_cycle();
+ * // ... wake, connect, send, receive, sleep ...
+ * LOGGER.println(meter.charge_mah(), 4);
+ *
+ * The defaults are typical ESP-01 figures at 3.3V.  Measure your own module
+ * and set them with set_state_current() if you want real numbers.
+ *
+ * Time comes from millis(), which stops while the AVR is powered down (see
+ * sleep_until_radio_data()).  The radio keeps drawing current during that
+ * time - account for it with add_time_ms() if you know how long you slept.
+ *
+ * Uses 57 bytes of SRAM per meter.
+ */
+
+#ifndef _LITEESP8266ENERGY_H_
+#define _LITEESP8266ENERGY_H_
+
+#include <Arduino.h>
+
+/**
+ * Radio states, as inferred from the command flow.
+ *
+ * OFF: CH_PD/EN low (power_off_radio()).
+ * DEEP_SLEEP: After deep_sleep_radio(), until the radio reboots.
+ * IDLE: Powered and awake, associated or not, with nothing in progress.  This
+ *   is the radio's modem sleep between beacons.
+ * TX: Sending data.
+ * RX_WAIT: Receiver on, waiting for the network - joining an AP, DNS,
+ *   connecting, or waiting for a response.
+ */
+#define LITE_ESP8266_STATE_OFF 0
+#define LITE_ESP8266_STATE_DEEP_SLEEP 1
+#define LITE_ESP8266_STATE_IDLE 2
+#define LITE_ESP8266_STATE_TX 3
+#define LITE_ESP8266_STATE_RX_WAIT 4
+#define LITE_ESP8266_STATE_COUNT 5
+
+// Default current draw per state, in microamps.
+#define LITE_ESP8266_CURRENT_OFF_UA 1UL
+#define LITE_ESP8266_CURRENT_DEEP_SLEEP_UA 20UL
+#define LITE_ESP8266_CURRENT_IDLE_UA 15000UL
+#define LITE_ESP8266_CURRENT_TX_UA 170000UL
+#define LITE_ESP8266_CURRENT_RX_WAIT_UA 56000UL
+
+class LiteESP8266EnergyMeter {
+public:
+  LiteESP8266EnergyMeter();
+
+  /**
+   * Set the current drawn in a state.
+   *
+   * @param state One of the LITE_ESP8266_STATE_ values.
+   * @param current_ua The current, in microamps.
+   */
+  void set_state_current(const uint8_t state, const unsigned long current_ua);
+
+  /**
+   * Called by the radio when its state changes.  You can call it too, if you
+   * know something the library doesn't (you cut the radio's power some other
+   * way, for instance).
+   *
+   * @param state One of the LITE_ESP8266_STATE_ values.
+   */
+  void set_state(const uint8_t state);
+
+  // The current state.
+  uint8_t state() { return state_; }
+
+  /**
+   * Add time spent in the current state that millis() didn't see - time the
+   * MCU was powered down, for instance.
+   *
+   * @param time_ms The time to add, in milliseconds.
+   */
+  void add_time_ms(const unsigned long time_ms);
+
+  /**
+   * Start a new cycle: clears the time and charge totals.  Call this at the
+   * start of each wake cycle.
+   */
+  void start_cycle();
+
+  /**
+   * Time spent in a state since start_cycle(), in milliseconds.
+   *
+   * @param state One of the LITE_ESP8266_STATE_ values.
+   */
+  unsigned long time_in_state_ms(const uint8_t state);
+
+  /**
+   * Charge used since start_cycle().  Microcoulombs (microamp-seconds) keep
+   * the resolution without floating point; charge_mah() is the friendlier
+   * number.
+   */
+  unsigned long charge_uc();
+  float charge_mah();
+
+  /**
+   * Measure a single operation: call begin_operation() before it, and
+   * operation_charge_uc() after for the charge it used.
+   */
+  void begin_operation();
+  unsigned long operation_charge_uc();
+
+private:
+  // Bring the totals up to the current time.
+  void accumulate();
+
+  // Account time_ms in the current state.
+  void add_charge(const unsigned long time_ms);
+
+  unsigned long state_current_ua_[LITE_ESP8266_STATE_COUNT];
+  unsigned long state_time_ms_[LITE_ESP8266_STATE_COUNT];
+  unsigned long charge_uc_;
+  unsigned long operation_start_uc_;
+
+  // Leftover fraction of a microcoulomb, in microamp-milliseconds, so lots
+  // of short intervals don't round down to nothing.
+  unsigned long remainder_ua_ms_;
+
+  unsigned long last_update_ms_;
+  uint8_t state_;
+};
+
+#endif // _LITEESP8266ENERGY_H_
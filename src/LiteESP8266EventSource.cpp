@@ -0,0 +1,354 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266EventSource.h"
+
+// Request pieces.
+const char SSE_GET[] PROGMEM = "GET ";
+const char SSE_HOST[] PROGMEM = " HTTP/1.0\r\nHost: ";
+const char SSE_ACCEPT[] PROGMEM =
+    "\r\nAccept: text/event-stream\r\nCache-Control: no-cache\r\n";
+const char SSE_LAST_EVENT_ID[] PROGMEM = "Last-Event-ID: ";
+const char SSE_LINE_END[] PROGMEM = "\r\n";
+
+// Field names.
+const char SSE_FIELD_DATA[] PROGMEM = "data";
+const char SSE_FIELD_EVENT[] PROGMEM = "event";
+const char SSE_FIELD_ID[] PROGMEM = "id";
+const char SSE_FIELD_RETRY[] PROGMEM = "retry";
+
+// The event name when there isn't one.
+const char SSE_DEFAULT_EVENT[] PROGMEM = "message";
+
+#define HTTP_OK 200
+
+// Parser states.  Values are read straight into where they go.
+#define SSE_STATE_FIELD 0
+#define SSE_STATE_IGNORE 1
+#define SSE_STATE_DATA 2
+#define SSE_STATE_EVENT 3
+#define SSE_STATE_ID 4
+#define SSE_STATE_RETRY 5
+
+LiteESP8266EventSource::LiteESP8266EventSource() {
+  radio_ = NULL;
+  buffer_ = NULL;
+  buffer_size_ = 0;
+  connected_ = false;
+  reconnects_ = 0;
+  id_[0] = 0;
+  reset_event();
+}
+
+bool LiteESP8266EventSource::begin(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const char *progmem_path, char *buffer, const unsigned int buffer_size,
+        esp8266_event_handler handler, void *context, const uint8_t link_id) {
+  radio_ = radio;
+  host_ = progmem_host;
+  port_ = port;
+  path_ = progmem_path;
+  buffer_ = buffer;
+  buffer_size_ = buffer_size;
+  handler_ = handler;
+  context_ = context;
+  link_id_ = link_id;
+  retry_ms_ = SSE_DEFAULT_RETRY_MS;
+  reconnects_ = 0;
+  id_[0] = 0;
+
+  connected_ = open();
+  if (!connected_) {
+    closed();
+  }
+  return connected_;
+}
+
+bool LiteESP8266EventSource::poll() {
+  int c;
+
+  if (!radio_) {
+    return false;
+  }
+  if (!connected_) {
+    if (LITE_ESP8266_ELAPSED_MS(closed_at_) < retry_ms_) {
+      return false;
+    }
+    connected_ = open();
+    if (!connected_) {
+      closed();
+      return false;
+    }
+    reconnects_++;
+  }
+
+  // Once a packet has started arriving, the rest of it is close behind.  A
+  // byte that starts something else mustn't stall the loop, so between
+  // packets the wait is only long enough for a header.
+  while (remaining_ || radio_->available()) {
+    c = radio_->read_packet_byte(&remaining_, remaining_ ?
+            COMMAND_RESPONSE_TIMEOUT : SSE_HEADER_TIMEOUT);
+    if (c == LITE_ESP8266_READ_CLOSED) {
+      closed();
+      break;
+    }
+    if (c == LITE_ESP8266_READ_TIMEOUT) {
+      break;
+    }
+    parse((char)c);
+  }
+  return connected_;
+}
+
+void LiteESP8266EventSource::stop() {
+  if (radio_ && connected_) {
+    radio_->close(link_id_);
+  }
+  connected_ = false;
+  radio_ = NULL;
+}
+
+void LiteESP8266EventSource::closed() {
+  connected_ = false;
+  closed_at_ = millis();
+}
+
+// =============================================================================
+// Opening the stream.
+// =============================================================================
+
+bool LiteESP8266EventSource::open() {
+  unsigned int length = strlen_P(SSE_GET) + strlen_P(path_) +
+      strlen_P(SSE_HOST) + strlen_P(host_) + strlen_P(SSE_ACCEPT) +
+      strlen_P(SSE_LINE_END);
+
+  // Anything half received went with the old connection.
+  remaining_ = 0;
+  reset_event();
+
+  if (id_[0]) {
+    length += strlen_P(SSE_LAST_EVENT_ID) + strlen(id_) +
+        strlen_P(SSE_LINE_END);
+  }
+
+  if (!radio_->connect_progmem(host_, port_, LITE_ESP8266_TCP, link_id_)) {
+    return false;
+  }
+  if (!radio_->begin_send(length, link_id_)) {
+    radio_->close(link_id_);
+    return false;
+  }
+  radio_->write_progmem(SSE_GET);
+  radio_->write_progmem(path_);
+  radio_->write_progmem(SSE_HOST);
+  radio_->write_progmem(host_);
+  radio_->write_progmem(SSE_ACCEPT);
+  if (id_[0]) {
+    radio_->write_progmem(SSE_LAST_EVENT_ID);
+    radio_->write_string(id_);
+    radio_->write_progmem(SSE_LINE_END);
+  }
+  radio_->write_progmem(SSE_LINE_END);
+
+  if (!radio_->end_send() || read_headers() != HTTP_OK) {
+    radio_->close(link_id_);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Looks like:
+ * HTTP/1.1 200 OK
+ * Content-Type: text/event-stream
+ * Cache-Control: no-cache
+ *
+ * Only the status matters.  The events may follow in the same packet.
+ */
+unsigned int LiteESP8266EventSource::read_headers() {
+  unsigned int status = 0;
+  uint8_t line = 0, spaces = 0;
+  unsigned int line_length = 0;
+  int c;
+
+  while (true) {
+    c = radio_->read_packet_byte(&remaining_, CLIENT_CONNECT_TIMEOUT);
+    if (c < 0) {
+      return 0;
+    }
+    if (c == '\n') {
+      if (!line_length) {
+        return status;
+      }
+      line++;
+      line_length = 0;
+    } else if (c != '\r') {
+      line_length++;
+      if (!line) {
+        // The status is the number after the first space.
+        if (c == ' ') {
+          spaces++;
+        } else if (spaces == 1 && c >= '0' && c <= '9') {
+          status = status * 10 + (c - '0');
+        }
+      }
+    }
+  }
+}
+
+// =============================================================================
+// Parsing the stream.  Lines end with "\r\n", '\r' or '\n'; each is a field
+// name, then optionally ':' and the value.  A blank line ends the event.
+// =============================================================================
+
+void LiteESP8266EventSource::reset_event() {
+  state_ = SSE_STATE_FIELD;
+  after_cr_ = false;
+  value_start_ = false;
+  field_length_ = 0;
+  value_length_ = 0;
+  data_length_ = 0;
+  event_[0] = 0;
+  strcpy(pending_id_, id_);
+}
+
+void LiteESP8266EventSource::parse(const char c) {
+  if (c == '\n' && after_cr_) {
+    // The rest of a "\r\n".
+    after_cr_ = false;
+    return;
+  }
+  after_cr_ = (c == '\r');
+  if (c == '\r' || c == '\n') {
+    end_line();
+    return;
+  }
+
+  if (state_ == SSE_STATE_FIELD) {
+    if (c != ':') {
+      if (field_length_ < SSE_FIELD_LENGTH - 1) {
+        field_[field_length_++] = c;
+      } else {
+        // Longer than any field there is.
+        state_ = SSE_STATE_IGNORE;
+      }
+      return;
+    }
+    // A comment if the name is empty; unknown fields are ignored.
+    field_[field_length_] = 0;
+    if (!field_length_) {
+      state_ = SSE_STATE_IGNORE;
+    } else if (!strcmp_P(field_, SSE_FIELD_DATA)) {
+      state_ = SSE_STATE_DATA;
+    } else if (!strcmp_P(field_, SSE_FIELD_EVENT)) {
+      state_ = SSE_STATE_EVENT;
+    } else if (!strcmp_P(field_, SSE_FIELD_ID)) {
+      state_ = SSE_STATE_ID;
+    } else if (!strcmp_P(field_, SSE_FIELD_RETRY)) {
+      state_ = SSE_STATE_RETRY;
+      retry_value_ = 0;
+      retry_valid_ = false;
+    } else {
+      state_ = SSE_STATE_IGNORE;
+    }
+    value_length_ = 0;
+    value_start_ = true;
+    return;
+  }
+
+  // One space after the colon isn't part of the value.
+  if (value_start_) {
+    value_start_ = false;
+    if (c == ' ') {
+      return;
+    }
+  }
+
+  switch (state_) {
+    case SSE_STATE_DATA:
+      // Leave room for the null.
+      if (data_length_ < buffer_size_ - 1) {
+        buffer_[data_length_++] = c;
+      }
+      break;
+    case SSE_STATE_EVENT:
+      if (value_length_ < SSE_EVENT_LENGTH - 1) {
+        event_[value_length_++] = c;
+      }
+      break;
+    case SSE_STATE_ID:
+      if (value_length_ < SSE_ID_LENGTH - 1) {
+        pending_id_[value_length_++] = c;
+      }
+      break;
+    case SSE_STATE_RETRY:
+      // Ignored unless it's all digits.
+      retry_valid_ = (c >= '0' && c <= '9') &&
+          (retry_valid_ || value_length_ == 0);
+      retry_value_ = retry_value_ * 10 + (c - '0');
+      value_length_++;
+      break;
+  }
+}
+
+void LiteESP8266EventSource::end_line() {
+  if (state_ == SSE_STATE_FIELD) {
+    if (!field_length_) {
+      dispatch();
+      return;
+    }
+    // A field name with no colon has an empty value.
+    field_[field_length_] = 0;
+    if (!strcmp_P(field_, SSE_FIELD_DATA)) {
+      state_ = SSE_STATE_DATA;
+    } else if (!strcmp_P(field_, SSE_FIELD_EVENT)) {
+      state_ = SSE_STATE_EVENT;
+    } else if (!strcmp_P(field_, SSE_FIELD_ID)) {
+      state_ = SSE_STATE_ID;
+    }
+    value_length_ = 0;
+  }
+
+  switch (state_) {
+    case SSE_STATE_DATA:
+      // Data lines are joined with '\n'.
+      if (data_length_ < buffer_size_ - 1) {
+        buffer_[data_length_++] = '\n';
+      }
+      break;
+    case SSE_STATE_EVENT:
+      event_[value_length_] = 0;
+      break;
+    case SSE_STATE_ID:
+      pending_id_[value_length_] = 0;
+      break;
+    case SSE_STATE_RETRY:
+      if (retry_valid_) {
+        retry_ms_ = retry_value_;
+      }
+      break;
+  }
+  state_ = SSE_STATE_FIELD;
+  field_length_ = 0;
+  value_start_ = false;
+}
+
+void LiteESP8266EventSource::dispatch() {
+  // The id counts once the event is complete, data or not.
+  strcpy(id_, pending_id_);
+
+  if (data_length_) {
+    // Drop the last line's '\n' - unless the buffer filled before it.  Data
+    // lines can't hold a '\n' of their own.
+    if (buffer_[data_length_ - 1] == '\n') {
+      data_length_--;
+    }
+    buffer_[data_length_] = 0;
+    if (!event_[0]) {
+      strcpy_P(event_, SSE_DEFAULT_EVENT);
+    }
+    handler_(event_, buffer_, context_);
+  }
+  data_length_ = 0;
+  event_[0] = 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * A Server-Sent Events client, for server push over plain HTTP.
+ *
+ * Where UDP is blocked, the usual way to get commands from a server is to poll
+ * it - a connection and a request every few seconds, and commands still wait
+ * half the poll interval on average.  An event stream (text/event-stream)
+ * turns that around: one GET that the server never finishes, writing each
+ * event to it as it happens:
+ *
+ * event: relay
+ * id: 42
+ * data: on
+ *
+ * The stream is parsed a byte at a time as the "+IPD" packets come in, and
+ * each complete event is handed to a handler, so a command arrives one trip
+ * across the network after the server has it.  If the connection closes, the
+ * client reconnects (after the server's "retry:" time, or a second) and sends
+ * the id of the last event it got in a Last-Event-ID header, so the server can
+ * replay anything sent in between.
+ *
+ * void on_event(const char *event, const char *data, void *context) {
+ *   if (!strcmp_P(event, PSTR("relay"))) {
+ *     digitalWrite(RELAY_PIN, !strcmp_P(data, PSTR("on")));
+ *   }
+ * }
+ *
+ * char data[64];
+ * LiteESP8266EventSource events;
+ * events.begin(&radio, host, 80, path, data, sizeof(data), on_event, NULL);
+ *
+ * void loop() {
+ *   events.poll();
+ *   // Everything else.
+ * }
+ *
+ * The data of one event is collected in the caller's buffer - multiple data
+ * lines joined with '\n' - and anything past its end is dropped.  Event names
+ * are cut to 15 characters and ids to 11.  Comments (lines starting with ':')
+ * are skipped, so the server can send them to keep the connection alive.
+ *
+ * Active receive mode only, and the stream's link should be the only one
+ * receiving while it's polled: packets for other links are read as if they
+ * were the stream's, and any link closing counts as the stream closing.  The
+ * object uses about 90 bytes of SRAM, plus the buffer.
+ */
+
+#ifndef _LITEESP8266EVENTSOURCE_H_
+#define _LITEESP8266EVENTSOURCE_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+// Reconnect delay until the server sets one with "retry:".
+#define SSE_DEFAULT_RETRY_MS 1000
+
+// How long poll() waits for the rest of a packet header once a byte is in -
+// "+IPD,4,2048:" takes 50ms at 2400 baud.  A stray byte that isn't a header
+// holds poll() up this long, at most.
+#define SSE_HEADER_TIMEOUT 100
+
+// Buffer sizes for the event name and id, including the null.
+#define SSE_EVENT_LENGTH 16
+#define SSE_ID_LENGTH 12
+
+// Long enough for the longest field name, "event" or "retry".
+#define SSE_FIELD_LENGTH 6
+
+/**
+ * Receives each event.
+ *
+ * @param event The event name - "message" if the server didn't give one.
+ * @param data The event data, null terminated.  Valid until the handler
+ *   returns.
+ * @param context The context passed to begin().
+ */
+typedef void (*esp8266_event_handler)(const char *event, const char *data,
+        void *context);
+
+class LiteESP8266EventSource {
+public:
+  LiteESP8266EventSource();
+
+  /**
+   * Open the event stream.  If that fails, poll() keeps trying.
+   *
+   * @param radio The radio.
+   * @param progmem_host The server (IP or DNS name), in program memory.
+   * @param port The server port.
+   * @param progmem_path The path of the stream, in program memory.
+   * @param buffer Where event data is collected.
+   * @param buffer_size The size of buffer, including room for the null.
+   * @param handler Called with each event.
+   * @param context Passed to handler.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @return True if the stream is open.
+   */
+  bool begin(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port, const char *progmem_path, char *buffer,
+          const unsigned int buffer_size, esp8266_event_handler handler,
+          void *context, const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Handle whatever has arrived, calling the handler for each complete event,
+   * and reconnect if the stream closed and the retry time has passed.  Call
+   * it from loop() - it doesn't wait for data that isn't there.  Bytes that
+   * aren't a packet cost it SSE_HEADER_TIMEOUT at most.
+   *
+   * @return True if the stream is open.
+   */
+  bool poll();
+
+  // Close the stream.  poll() does nothing until the next begin().
+  void stop();
+
+  // The id of the last event, sent as Last-Event-ID on reconnecting.
+  const char *last_event_id() { return id_; }
+
+  // How many times the stream has been reopened since begin().
+  unsigned int reconnects() { return reconnects_; }
+
+private:
+  /**
+   * Connect, send the request, and read the response headers.
+   *
+   * @return True if the server answered "200".
+   */
+  bool open();
+
+  // Read to the end of the response headers.  Returns the HTTP status.
+  unsigned int read_headers();
+
+  // The stream closed: note the time, for the retry delay.
+  void closed();
+
+  // Parse a byte of the stream.
+  void parse(const char c);
+
+  // End of a line: act on the field.
+  void end_line();
+
+  // A blank line: hand the event over, and start a new one.
+  void dispatch();
+
+  // Start a new event, forgetting anything half parsed.
+  void reset_event();
+
+  LiteESP8266 *radio_;
+  const char *host_;
+  const char *path_;
+  unsigned int port_;
+  uint8_t link_id_;
+
+  esp8266_event_handler handler_;
+  void *context_;
+  char *buffer_;
+  unsigned int buffer_size_;
+  unsigned int data_length_;
+
+  bool connected_;
+  unsigned long closed_at_;
+  unsigned long retry_ms_;
+  unsigned int reconnects_;
+
+  // Bytes left in the current "+IPD" packet.
+  unsigned int remaining_;
+
+  // Where the parser is in the current line, and what it has of it.
+  uint8_t state_;
+  bool after_cr_;
+  bool value_start_;
+  char field_[SSE_FIELD_LENGTH];
+  uint8_t field_length_;
+  uint8_t value_length_;
+  unsigned long retry_value_;
+  bool retry_valid_;
+
+  char event_[SSE_EVENT_LENGTH];
+  // The id being received, and the id of the last complete event.
+  char pending_id_[SSE_ID_LENGTH];
+  char id_[SSE_ID_LENGTH];
+};
+
+#endif // _LITEESP8266EVENTSOURCE_H_
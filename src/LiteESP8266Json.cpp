@@ -0,0 +1,288 @@
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "LiteESP8266Json.h"
+
+const char JSON_TRUE[] PROGMEM = "true";
+const char JSON_FALSE[] PROGMEM = "false";
+const char JSON_NULL[] PROGMEM = "null";
+
+// Floats at or past this don't fit an unsigned long.
+#define JSON_FLOAT_LIMIT 4294967040.0
+
+#define JSON_MAX_DECIMALS 6
+
+LiteESP8266JsonWriter::LiteESP8266JsonWriter() {
+  start(NULL, 0);
+}
+
+void LiteESP8266JsonWriter::start(LiteESP8266 *radio,
+        const unsigned int limit) {
+  radio_ = radio;
+  length_ = 0;
+  limit_ = limit;
+  need_comma_ = false;
+  overflow_ = false;
+}
+
+// =============================================================================
+// Running the builder.
+// =============================================================================
+
+unsigned int LiteESP8266JsonWriter::measure(esp8266_json_builder builder,
+        void *context) {
+  start(NULL, 0);
+  builder(this, context);
+  return length_;
+}
+
+uint8_t LiteESP8266JsonWriter::send(LiteESP8266 *radio,
+        esp8266_json_builder builder, void *context, const uint8_t link_id) {
+  unsigned int length = measure(builder, context);
+  bool written;
+
+  if (length > LITE_ESP8266_MAX_SEND_LENGTH) {
+    return LITE_ESP8266_LENGTH_EXCEEDED;
+  }
+  if (!radio->begin_send(length, link_id)) {
+    return LITE_ESP8266_FAILURE;
+  }
+  written = write(radio, builder, context, length);
+  return (radio->end_send() && written) ? LITE_ESP8266_SUCCESS :
+      LITE_ESP8266_FAILURE;
+}
+
+bool LiteESP8266JsonWriter::write(LiteESP8266 *radio,
+        esp8266_json_builder builder, void *context,
+        const unsigned int length) {
+  start(radio, length);
+  builder(this, context);
+  // Came out short.  The radio is still waiting for bytes, and would take the
+  // next command as data - whitespace is harmless after the document.
+  while (length_ < limit_) {
+    put(' ');
+  }
+
+  radio_ = NULL;
+  return !overflow_;
+}
+
+// =============================================================================
+// Document structure.  A single flag is enough to place the commas: it's
+// cleared by opening a container or writing a key, and set by any value -
+// including a container that just closed, which is a value of its parent.
+// =============================================================================
+
+void LiteESP8266JsonWriter::begin_object() {
+  separate();
+  put('{');
+  need_comma_ = false;
+}
+
+void LiteESP8266JsonWriter::end_object() {
+  put('}');
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::begin_array() {
+  separate();
+  put('[');
+  need_comma_ = false;
+}
+
+void LiteESP8266JsonWriter::end_array() {
+  put(']');
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::key(const char *progmem_key) {
+  separate();
+  put('"');
+  put_progmem(progmem_key);
+  put('"');
+  put(':');
+  need_comma_ = false;
+}
+
+void LiteESP8266JsonWriter::separate() {
+  if (need_comma_) {
+    put(',');
+  }
+}
+
+// =============================================================================
+// Values.
+// =============================================================================
+
+void LiteESP8266JsonWriter::string(const char *value) {
+  separate();
+  put('"');
+  while (*value) {
+    put_escaped(*value++);
+  }
+  put('"');
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::string_progmem(const char *progmem_value) {
+  char c;
+
+  separate();
+  put('"');
+  while ((c = pgm_read_byte(progmem_value++))) {
+    put_escaped(c);
+  }
+  put('"');
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::number(const long value) {
+  // "-2147483648" and the null.
+  char digits[12];
+
+  separate();
+  put_string(ltoa(value, digits, 10));
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::number_unsigned(const unsigned long value) {
+  char digits[11];
+
+  separate();
+  put_string(ultoa(value, digits, 10));
+  need_comma_ = true;
+}
+
+/**
+ * The same digit at a time method as Print::print(double), so the two runs
+ * come out identical without needing a dtostrf buffer.
+ */
+void LiteESP8266JsonWriter::number_float(double value, uint8_t decimals) {
+  char digits[11];
+  double rounding = 0.5;
+  unsigned long whole;
+  uint8_t digit;
+
+  if (isnan(value) || isinf(value) || fabs(value) >= JSON_FLOAT_LIMIT) {
+    null_value();
+    return;
+  }
+  if (decimals > JSON_MAX_DECIMALS) {
+    decimals = JSON_MAX_DECIMALS;
+  }
+
+  separate();
+  if (value < 0.0) {
+    put('-');
+    value = -value;
+  }
+  for (digit = 0; digit < decimals; digit++) {
+    rounding /= 10.0;
+  }
+  value += rounding;
+
+  whole = (unsigned long)value;
+  put_string(ultoa(whole, digits, 10));
+  value -= (double)whole;
+  if (decimals) {
+    put('.');
+  }
+  while (decimals--) {
+    value *= 10.0;
+    digit = (uint8_t)value;
+    put('0' + digit);
+    value -= digit;
+  }
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::boolean_value(const bool value) {
+  separate();
+  put_progmem(value ? JSON_TRUE : JSON_FALSE);
+  need_comma_ = true;
+}
+
+void LiteESP8266JsonWriter::null_value() {
+  separate();
+  put_progmem(JSON_NULL);
+  need_comma_ = true;
+}
+
+// =============================================================================
+// Output.  Every piece goes through fits(), which counts it and says whether
+// to write it to the radio.
+// =============================================================================
+
+bool LiteESP8266JsonWriter::fits(const unsigned int length) {
+  bool room = length_ + length <= limit_;
+
+  if (radio_ && !room) {
+    // The send can't take the piece - make it up to its length instead.
+    while (length_ < limit_) {
+      radio_->write(' ');
+      length_++;
+    }
+    overflow_ = true;
+  }
+  length_ += length;
+  return radio_ && room;
+}
+
+void LiteESP8266JsonWriter::put(const char c) {
+  if (fits(1)) {
+    radio_->write(c);
+  }
+}
+
+void LiteESP8266JsonWriter::put_string(const char *string) {
+  if (fits(strlen(string))) {
+    radio_->write_string(string);
+  }
+}
+
+void LiteESP8266JsonWriter::put_progmem(const char *progmem_string) {
+  if (fits(strlen_P(progmem_string))) {
+    radio_->write_progmem(progmem_string);
+  }
+}
+
+// The low four bits, as a hex digit.
+static char hex_digit(const uint8_t value) {
+  uint8_t nibble = value & 0x0F;
+  return (nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10);
+}
+
+void LiteESP8266JsonWriter::put_escaped(const char c) {
+  switch (c) {
+    case '"':
+    case '\\':
+      put('\\');
+      put(c);
+      break;
+    case '\n':
+      put('\\');
+      put('n');
+      break;
+    case '\r':
+      put('\\');
+      put('r');
+      break;
+    case '\t':
+      put('\\');
+      put('t');
+      break;
+    default:
+      if ((unsigned char)c < 0x20) {
+        // Other control characters: \u00XX.
+        put('\\');
+        put('u');
+        put('0');
+        put('0');
+        put(hex_digit(c >> 4));
+        put(hex_digit(c));
+      } else {
+        put(c);
+      }
+  }
+}
@@ -0,0 +1,183 @@
+/**
+ * A JSON writer that sends straight to the radio.
+ *
+ * The usual way to send a JSON document is to snprintf it into a buffer and
+ * send() the buffer - and for a few hundred bytes of status, that buffer is
+ * the biggest thing in SRAM.  This writes the document a value at a time
+ * instead, with no buffer at all.  The document is built by a function of
+ * yours, which is run twice: once to count the bytes, so the radio can be
+ * told the length up front, and once to write them into a single send.
+ *
+ * void build_status(LiteESP8266JsonWriter *json, void *context) {
+ *   Status *status = (Status *)context;
+ *   json->begin_object();
+ *   json->key(key_battery_mv);
+ *   json->number(status->battery_mv);
+ *   json->key(key_readings);
+ *   json->begin_array();
+ *   for (uint8_t i = 0; i < status->count; i++) {
+ *     json->number_float(status->readings[i], 1);
+ *   }
+ *   json->end_array();
+ *   json->end_object();
+ * }
+ *
+ * LiteESP8266JsonWriter json;
+ * json.send(&radio, build_status, &status);
+ *
+ * send() is the document alone.  For an HTTP request, measure() it for the
+ * Content-Length, and put the headers and the document in one send:
+ *
+ * unsigned int length = json.measure(build_status, &status);
+ * // Write the headers to a buffer, with Content-Length: length, then:
+ * radio.begin_send(strlen(headers) + length);
+ * for (char *c = headers; *c; c++) {
+ *   radio.write(*c);
+ * }
+ * json.write(&radio, build_status, &status, length);
+ * radio.end_send();
+ *
+ * The function must write the same thing both times - read the sensors
+ * before, not during.  If the second run comes out longer, the send is cut
+ * short at the piece that runs past its end and padded with spaces, and send()
+ * or write() fails; if shorter, the rest is padded with spaces too.
+ *
+ * Keys are always in program memory.  The writer uses 8 bytes of SRAM.
+ */
+
+#ifndef _LITEESP8266JSON_H_
+#define _LITEESP8266JSON_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+class LiteESP8266JsonWriter;
+
+/**
+ * Builds a document, by calling the writer's functions in order.
+ *
+ * @param json The writer.
+ * @param context The context passed to measure(), send() or write().
+ */
+typedef void (*esp8266_json_builder)(LiteESP8266JsonWriter *json,
+        void *context);
+
+class LiteESP8266JsonWriter {
+public:
+  LiteESP8266JsonWriter();
+
+  /**
+   * Count the bytes in a document, without sending anything.
+   *
+   * @param builder Builds the document.
+   * @param context Passed to builder.
+   * @return The length of the document.
+   */
+  unsigned int measure(esp8266_json_builder builder, void *context);
+
+  /**
+   * Send a document in one send, written straight to the radio.  This
+   * measures it first, so the builder runs twice.
+   *
+   * @param radio The radio, with a connection open.
+   * @param builder Builds the document.
+   * @param context Passed to builder.
+   * @param link_id The link to send on with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @return LITE_ESP8266_SUCCESS, LITE_ESP8266_LENGTH_EXCEEDED if the document
+   *   is over LITE_ESP8266_MAX_SEND_LENGTH, or LITE_ESP8266_FAILURE if the send
+   *   failed or the document changed between runs.
+   */
+  uint8_t send(LiteESP8266 *radio, esp8266_json_builder builder,
+          void *context, const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Write a document measure() has counted into a send already started with
+   * the radio's begin_send(), after anything else in it - the builder runs
+   * once.  Finish with the radio's end_send().
+   *
+   * @param radio The radio, in a send.
+   * @param builder Builds the document.
+   * @param context Passed to builder.
+   * @param length The length measure() gave: exactly this many bytes are
+   *   written.
+   * @return False if the document came out longer than length.
+   */
+  bool write(LiteESP8266 *radio, esp8266_json_builder builder, void *context,
+          const unsigned int length);
+
+  // Containers.  Nest as deep as you like.
+  void begin_object();
+  void end_object();
+  void begin_array();
+  void end_array();
+
+  /**
+   * Start a member of an object.  Follow it with exactly one value.
+   *
+   * @param progmem_key The key, in program memory.  Written as is, so it
+   *   must not need escaping.
+   */
+  void key(const char *progmem_key);
+
+  /**
+   * Strings, quoted and escaped.
+   *
+   * @param value The string, null terminated, in data or program memory.
+   */
+  void string(const char *value);
+  void string_progmem(const char *progmem_value);
+
+  // Numbers.
+  void number(const long value);
+  void number_unsigned(const unsigned long value);
+
+  /**
+   * A number with a fixed number of decimals, rounded.  NaN, infinities and
+   * anything too big for an unsigned long are written as null.
+   *
+   * @param value The number.
+   * @param decimals Digits after the point, 0 to 6.
+   */
+  void number_float(double value, uint8_t decimals = 2);
+
+  void boolean_value(const bool value);
+  void null_value();
+
+  // Bytes written so far in this run.
+  unsigned int length() { return length_; }
+
+private:
+  // Start a run.  With a radio, bytes go to it, up to limit; without, they're
+  // only counted.
+  void start(LiteESP8266 *radio, const unsigned int limit);
+
+  // The comma before a value or key, if it needs one.
+  void separate();
+
+  /**
+   * Count length more bytes.  Past the limit, the send is filled out with
+   * spaces instead, and the run has overflowed.
+   *
+   * @return True if the bytes are to be written to the radio.
+   */
+  bool fits(const unsigned int length);
+
+  void put(const char c);
+  void put_string(const char *string);
+  void put_progmem(const char *progmem_string);
+  void put_escaped(const char c);
+
+  LiteESP8266 *radio_;
+  unsigned int length_;
+  unsigned int limit_;
+
+  // A value has been written at this level, so the next needs a comma.
+  bool need_comma_;
+
+  // More was written than the limit - the send was cut short.
+  bool overflow_;
+};
+
+#endif // _LITEESP8266JSON_H_
@@ -0,0 +1,108 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266LineReader.h"
+
+const char LINE_CONTENT_LENGTH[] PROGMEM = "Content-Length:";
+
+// No Content-Length: the body runs until the connection closes.
+#define LINE_UNKNOWN_LENGTH 0xFFFFFFFFUL
+
+LiteESP8266LineReader::LiteESP8266LineReader(LiteESP8266 *radio,
+        char *buffer, const unsigned int buffer_size) {
+  radio_ = radio;
+  buffer_ = buffer;
+  buffer_size_ = buffer_size;
+  length_ = 0;
+  remaining_ = 0;
+  body_left_ = LINE_UNKNOWN_LENGTH;
+  truncated_lines_ = 0;
+  truncated_ = false;
+  timed_out_ = false;
+  ended_ = false;
+  buffer_[0] = 0;
+}
+
+/**
+ * Looks like:
+ * HTTP/1.1 200 OK
+ * Content-Type: text/csv
+ * Content-Length: 1834
+ *
+ * The header names are case insensitive.
+ */
+unsigned int LiteESP8266LineReader::read_headers(
+        const unsigned int timeout_ms) {
+  unsigned long content_length = LINE_UNKNOWN_LENGTH;
+  unsigned int status = 0;
+  char *field;
+
+  if (!next_line(timeout_ms)) {
+    return 0;
+  }
+  field = strchr(buffer_, ' ');
+  if (field) {
+    status = atoi(field + 1);
+  }
+
+  // Up to the blank line.
+  while (next_line(timeout_ms) && length_) {
+    if (!strncasecmp_P(buffer_, LINE_CONTENT_LENGTH,
+            strlen_P(LINE_CONTENT_LENGTH))) {
+      content_length = strtoul(buffer_ + strlen_P(LINE_CONTENT_LENGTH), NULL,
+              10);
+    }
+  }
+  if (timed_out_) {
+    return 0;
+  }
+  body_left_ = content_length;
+  return status;
+}
+
+bool LiteESP8266LineReader::next_line(const unsigned int timeout_ms) {
+  int c;
+
+  length_ = 0;
+  truncated_ = false;
+  buffer_[0] = 0;
+  if (ended_) {
+    return false;
+  }
+
+  while (body_left_) {
+    c = radio_->read_packet_byte(&remaining_, timeout_ms);
+    if (c == LITE_ESP8266_READ_TIMEOUT) {
+      // Half a line is no use to anyone.
+      timed_out_ = true;
+      ended_ = true;
+      return false;
+    }
+    if (c == LITE_ESP8266_READ_CLOSED) {
+      break;
+    }
+    if (body_left_ != LINE_UNKNOWN_LENGTH) {
+      body_left_--;
+    }
+
+    if (c == '\n') {
+      buffer_[length_] = 0;
+      return true;
+    }
+    if (c == '\r') {
+      // Dropped, so "\r\n" ends a line as well.
+      continue;
+    }
+    if (length_ < buffer_size_ - 1) {
+      buffer_[length_++] = c;
+    } else if (!truncated_) {
+      truncated_ = true;
+      truncated_lines_++;
+    }
+  }
+
+  // The end of the body.  A last line without a '\n' still counts.
+  ended_ = true;
+  buffer_[length_] = 0;
+  return length_ || truncated_;
+}
@@ -0,0 +1,98 @@
+/**
+ * Line at a time reading of HTTP responses.
+ *
+ * Line oriented data - a CSV schedule, key=value config - is usually fetched
+ * with get_http_response() and then split up, which needs the whole body in
+ * SRAM at once.  This hands it over a line at a time instead, read straight
+ * from the "+IPD" packets into a small buffer as they arrive, so memory is
+ * bounded by the longest line rather than the body, and lines can span
+ * packets.
+ *
+ * char line[48];
+ * LiteESP8266LineReader lines(&radio, line, sizeof(line));
+ * radio.send_progmem(request);
+ * if (lines.read_headers() == 200) {
+ *   while (lines.next_line()) {
+ *     // Use line - lines.truncated() if it didn't fit.
+ *   }
+ * }
+ * radio.close();
+ *
+ * Lines end with '\n', which isn't kept.  '\r's are dropped, so "\r\n" works
+ * too.  A line longer than the buffer is cut to fit, the rest of it skipped,
+ * and truncated() is set for it.  The body ends after Content-Length bytes
+ * or, without one, when the connection closes - so ask with HTTP/1.0, or
+ * "Connection: close", to keep chunked encoding out of it.
+ *
+ * Active receive mode only.  The reader uses 19 bytes of SRAM, plus the
+ * buffer.
+ */
+
+#ifndef _LITEESP8266LINEREADER_H_
+#define _LITEESP8266LINEREADER_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+class LiteESP8266LineReader {
+public:
+  /**
+   * @param radio The radio, with the request sent.
+   * @param buffer Where each line goes.
+   * @param buffer_size The size of buffer, including room for the null.
+   */
+  LiteESP8266LineReader(LiteESP8266 *radio, char *buffer,
+          const unsigned int buffer_size);
+
+  /**
+   * Read the response headers, up to the blank line, noting Content-Length.
+   * Skip this for data that has no headers.
+   *
+   * @param timeout_ms How long to wait for the response to start, and for
+   *   each byte after.
+   * @return The HTTP status, or 0 if there was no response.
+   */
+  unsigned int read_headers(
+          const unsigned int timeout_ms = CLIENT_CONNECT_TIMEOUT);
+
+  /**
+   * Read the next line into the buffer.  read_headers() uses this too, and
+   * the headers don't count against the body.
+   *
+   * @param timeout_ms How long to wait for each byte.
+   * @return True with a line in the buffer, false at the end of the body, or
+   *   if it stopped arriving - see timed_out().
+   */
+  bool next_line(const unsigned int timeout_ms = COMMAND_RESPONSE_TIMEOUT);
+
+  // The current line, and its length.
+  const char *line() { return buffer_; }
+  unsigned int length() { return length_; }
+
+  // True if the current line was longer than the buffer and got cut short.
+  bool truncated() { return truncated_; }
+
+  // How many lines have been cut short so far, headers included.
+  unsigned int truncated_lines() { return truncated_lines_; }
+
+  // True if the body ended because nothing arrived in time.
+  bool timed_out() { return timed_out_; }
+
+private:
+  LiteESP8266 *radio_;
+  char *buffer_;
+  unsigned int buffer_size_;
+  unsigned int length_;
+
+  // Bytes left in the current "+IPD" packet, and in the body.
+  unsigned int remaining_;
+  unsigned long body_left_;
+
+  unsigned int truncated_lines_;
+  bool truncated_;
+  bool timed_out_;
+  bool ended_;
+};
+
+#endif // _LITEESP8266LINEREADER_H_
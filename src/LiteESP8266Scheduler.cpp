@@ -0,0 +1,167 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266Scheduler.h"
+
+LiteESP8266Scheduler::LiteESP8266Scheduler() {
+  radio_ = NULL;
+  queue_ = NULL;
+  links_held_ = 0;
+  links_ = 1;
+}
+
+bool LiteESP8266Scheduler::begin(LiteESP8266 *radio, const uint8_t links) {
+  radio_ = radio;
+  links_ = links;
+  if (links_ < 1) {
+    links_ = 1;
+  }
+  if (links_ > LITE_ESP8266_MAX_LINKS) {
+    links_ = LITE_ESP8266_MAX_LINKS;
+  }
+  if (links_ == 1) {
+    return radio_->set_multiple_connections(false);
+  }
+  // Held by the radio, each link's data waits for its own transaction.
+  return radio_->set_multiple_connections(true) &&
+      radio_->set_passive_receive(true);
+}
+
+bool LiteESP8266Scheduler::submit(esp8266_transaction *transaction) {
+  esp8266_transaction **tail = &queue_;
+
+  // Walk to the end, making sure it's not already here.
+  while (*tail) {
+    if (*tail == transaction) {
+      return false;
+    }
+    tail = &((*tail)->next);
+  }
+
+  transaction->step = 0;
+  transaction->state = LITE_ESP8266_TRANSACTION_QUEUED;
+  transaction->link_id = LITE_ESP8266_NO_LINK;
+  transaction->next = NULL;
+  *tail = transaction;
+  return true;
+}
+
+bool LiteESP8266Scheduler::cancel(esp8266_transaction *transaction) {
+  esp8266_transaction *queued;
+
+  for (queued = queue_; queued; queued = queued->next) {
+    if (queued == transaction) {
+      if (transaction->state == LITE_ESP8266_TRANSACTION_RUNNING) {
+        // Let it close the connection.  It's going away either way.
+        transaction->step_function(radio_, transaction,
+                LITE_ESP8266_EVENT_SUSPEND);
+      }
+      remove(transaction, LITE_ESP8266_TRANSACTION_IDLE);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LiteESP8266Scheduler::run_once() {
+  esp8266_transaction *transaction = next_transaction();
+  uint8_t result;
+
+  if (!transaction) {
+    return false;
+  }
+
+  result = transaction->step_function(radio_, transaction,
+          LITE_ESP8266_EVENT_RUN);
+  if (result == LITE_ESP8266_STEP_DONE) {
+    remove(transaction, LITE_ESP8266_TRANSACTION_DONE);
+  } else if (result == LITE_ESP8266_STEP_FAILED) {
+    remove(transaction, LITE_ESP8266_TRANSACTION_FAILED);
+  }
+  return true;
+}
+
+esp8266_transaction *LiteESP8266Scheduler::next_transaction() {
+  esp8266_transaction *best = NULL, *victim = NULL, *transaction;
+  uint8_t link;
+
+  // Highest priority wins; the queue is in submission order, so the first
+  // found at a priority is the oldest.
+  for (transaction = queue_; transaction; transaction = transaction->next) {
+    if (!best || transaction->priority < best->priority) {
+      best = transaction;
+    }
+  }
+  if (!best || best->state == LITE_ESP8266_TRANSACTION_RUNNING) {
+    return best;
+  }
+
+  // It needs a link.  If they're all held, take one from the least important
+  // holder - the newest, if there's a tie - provided it's less important.
+  if (links_held_ == (1 << links_) - 1) {
+    for (transaction = queue_; transaction; transaction = transaction->next) {
+      if (transaction->state == LITE_ESP8266_TRANSACTION_RUNNING &&
+              transaction->priority > best->priority &&
+              (!victim || transaction->priority >= victim->priority)) {
+        victim = transaction;
+      }
+    }
+    if (!victim) {
+      // Every link is held by something just as important.  Let the first of
+      // those carry on.
+      for (transaction = queue_; transaction; transaction = transaction->next) {
+        if (transaction->state == LITE_ESP8266_TRANSACTION_RUNNING &&
+                transaction->priority == best->priority) {
+          return transaction;
+        }
+      }
+      return NULL;
+    }
+    suspend(victim);
+  }
+
+  // Lowest free link.
+  for (link = 0; links_held_ & (1 << link); link++);
+  links_held_ |= (1 << link);
+  best->link_id = (links_ > 1) ? link : LITE_ESP8266_NO_LINK;
+  best->state = LITE_ESP8266_TRANSACTION_RUNNING;
+  return best;
+}
+
+void LiteESP8266Scheduler::suspend(esp8266_transaction *transaction) {
+  if (transaction->step_function(radio_, transaction,
+          LITE_ESP8266_EVENT_SUSPEND) == LITE_ESP8266_STEP_FAILED) {
+    remove(transaction, LITE_ESP8266_TRANSACTION_FAILED);
+    return;
+  }
+  links_held_ &= ~link_bit(transaction);
+  transaction->link_id = LITE_ESP8266_NO_LINK;
+  transaction->state = LITE_ESP8266_TRANSACTION_QUEUED;
+}
+
+void LiteESP8266Scheduler::remove(esp8266_transaction *transaction,
+        const uint8_t state) {
+  esp8266_transaction **link = &queue_;
+
+  while (*link && *link != transaction) {
+    link = &((*link)->next);
+  }
+  if (*link) {
+    *link = transaction->next;
+  }
+
+  if (transaction->state == LITE_ESP8266_TRANSACTION_RUNNING) {
+    links_held_ &= ~link_bit(transaction);
+  }
+  transaction->next = NULL;
+  transaction->link_id = LITE_ESP8266_NO_LINK;
+  transaction->state = state;
+}
+
+uint8_t LiteESP8266Scheduler::link_bit(esp8266_transaction *transaction) {
+  // With a single link, bit 0 stands for it.
+  if (transaction->link_id == LITE_ESP8266_NO_LINK) {
+    return 1;
+  }
+  return 1 << transaction->link_id;
+}
@@ -0,0 +1,193 @@
+/**
+ * A priority scheduler for radio transactions.
+ *
+ * Every call in LiteESP8266 blocks until the radio is done, so an alarm raised
+ * during a 30KB upload waits for the whole upload.  The scheduler fixes that by
+ * breaking work into transactions - a connect, some sends, a receive - that
+ * run one step at a time.  After every step, the highest priority transaction
+ * that's waiting gets the next one.  A long upload that sends one segment per
+ * step holds an alarm up by one segment, not by the whole upload.
+ *
+ * What happens to the transaction that got bumped depends on the links:
+ *
+ * - With multiple connections (begin() with links > 1), the alarm gets its
+ *   own link and the upload's connection stays open, idle, until the alarm is
+ *   done.  The radio is put in passive receive mode (AT firmware 1.7 or
+ *   newer), so anything the upload's server sends meanwhile is held by the
+ *   radio, per link, until the upload reads it.  Steps read with
+ *   read_passive_data(), passing transaction->link_id - a read only ever
+ *   gets its own link's data.  get_response_packet(), get_http_response() and
+ *   read_packet_byte() take the next packet from any link, and are for a
+ *   single link only.
+ * - With a single link, or with every link taken, the lowest priority
+ *   transaction holding a link is suspended: its step function is called with
+ *   LITE_ESP8266_EVENT_SUSPEND, and must close its connection and note where
+ *   it was.  When it next runs it has to reconnect and carry on - an upload
+ *   resumes from the last acknowledged offset, for instance.
+ *
+ * Transactions are structures owned by the caller (statically allocated,
+ * usually), linked into the queue - the scheduler allocates nothing.  The
+ * step function does the work:
+ *
+ * uint8_t send_alarm(LiteESP8266 *radio, esp8266_transaction *transaction,
+ *         const uint8_t event) {
+ *   if (event == LITE_ESP8266_EVENT_SUSPEND) {
+ *     radio->close(transaction->link_id);
+ *     transaction->step = 0;
+ *     return LITE_ESP8266_STEP_CONTINUE;
+ *   }
+ *   switch (transaction->step++) {
+ *     case 0:
+ *       return radio->connect_progmem(host, 80, LITE_ESP8266_TCP,
+ *               transaction->link_id) ?
+ *           LITE_ESP8266_STEP_CONTINUE : LITE_ESP8266_STEP_FAILED;
+ *     case 1:
+ *       ...
+ *     default:
+ *       // One read per step.  Nothing yet is fine - try again next time.
+ *       length = radio->read_passive_data(buffer, sizeof(buffer),
+ *               COMMAND_RESPONSE_TIMEOUT, transaction->link_id);
+ *       ...
+ *   }
+ *   return LITE_ESP8266_STEP_DONE;
+ * }
+ *
+ * Uses 6 bytes of SRAM per scheduler, and 10 per transaction.
+ */
+
+#ifndef _LITEESP8266SCHEDULER_H_
+#define _LITEESP8266SCHEDULER_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+// Priorities.  Lower runs first; within a priority, first come first served.
+#define LITE_ESP8266_PRIORITY_ALARM 0
+#define LITE_ESP8266_PRIORITY_NORMAL 1
+#define LITE_ESP8266_PRIORITY_BULK 2
+
+// Events passed to a step function.
+#define LITE_ESP8266_EVENT_RUN 0
+#define LITE_ESP8266_EVENT_SUSPEND 1
+
+// Step function results.
+#define LITE_ESP8266_STEP_CONTINUE 0
+#define LITE_ESP8266_STEP_DONE 1
+#define LITE_ESP8266_STEP_FAILED 2
+
+// Transaction states, as seen by the caller.
+#define LITE_ESP8266_TRANSACTION_IDLE 0
+#define LITE_ESP8266_TRANSACTION_QUEUED 1
+#define LITE_ESP8266_TRANSACTION_RUNNING 2
+#define LITE_ESP8266_TRANSACTION_DONE 3
+#define LITE_ESP8266_TRANSACTION_FAILED 4
+
+struct esp8266_transaction;
+
+/**
+ * Do one step of a transaction.  A step should be one bounded piece of work -
+ * a connect, one send, one packet read - as nothing else can run until it
+ * returns.
+ *
+ * For LITE_ESP8266_EVENT_RUN, do the next step, using transaction->link_id
+ * for every connect, send and close.  For LITE_ESP8266_EVENT_SUSPEND, close
+ * the connection and get ready to start over on a new link; the return value
+ * is ignored unless it's LITE_ESP8266_STEP_FAILED.
+ *
+ * @param radio The radio.
+ * @param transaction The transaction - context and step are yours to use.
+ * @param event LITE_ESP8266_EVENT_RUN or LITE_ESP8266_EVENT_SUSPEND.
+ * @return LITE_ESP8266_STEP_CONTINUE to be called again, or _DONE or _FAILED
+ *   to finish.
+ */
+typedef uint8_t (*esp8266_transaction_step)(LiteESP8266 *radio,
+        esp8266_transaction *transaction, const uint8_t event);
+
+struct esp8266_transaction {
+  // Set these before submitting.
+  esp8266_transaction_step step_function;
+  void *context;
+  uint8_t priority;
+
+  // For the step function's use - reset to 0 by submit().
+  uint8_t step;
+
+  // Managed by the scheduler.  link_id is valid while running - a running
+  // transaction holds a link, a queued one doesn't.
+  uint8_t state;
+  uint8_t link_id;
+  esp8266_transaction *next;
+};
+
+class LiteESP8266Scheduler {
+public:
+  LiteESP8266Scheduler();
+
+  /**
+   * Attach the scheduler to a radio that's been through begin().
+   *
+   * With links greater than 1, multiple connections and passive receive mode
+   * are turned on, and up to that many transactions can hold connections at
+   * once.  Transactions get link ids 0 through links - 1, and read with
+   * read_passive_data().  With 1 link, transactions get LITE_ESP8266_NO_LINK
+   * and take turns, and the receive mode is left alone.
+   *
+   * @param radio The radio.  Not owned, must outlive the scheduler.
+   * @param links How many connections to use, 1 to LITE_ESP8266_MAX_LINKS.
+   * @return True if the radio accepted the connection and receive modes.
+   */
+  bool begin(LiteESP8266 *radio, const uint8_t links = 1);
+
+  /**
+   * Queue a transaction.  Its step is reset to 0.  The transaction must stay
+   * in memory until it's done, failed, or cancelled.
+   *
+   * @param transaction The transaction, with step_function, context and
+   *   priority set.
+   * @return False if the transaction is already queued.
+   */
+  bool submit(esp8266_transaction *transaction);
+
+  /**
+   * Remove a transaction from the queue.  A running transaction is suspended
+   * first, so it can close its connection.  The state goes back to
+   * LITE_ESP8266_TRANSACTION_IDLE.
+   *
+   * @param transaction The transaction.
+   * @return False if the transaction wasn't queued.
+   */
+  bool cancel(esp8266_transaction *transaction);
+
+  /**
+   * Run one step of the highest priority transaction.  Call this from loop().
+   *
+   * @return True if a step ran, false if there was nothing to do.
+   */
+  bool run_once();
+
+  // True if nothing is queued.
+  bool idle() { return queue_ == NULL; }
+
+private:
+  // Pick the transaction to run next, and get it a link.  NULL if none.
+  esp8266_transaction *next_transaction();
+
+  // Take the transaction's link away, telling it first.
+  void suspend(esp8266_transaction *transaction);
+
+  // Unlink a finished transaction and free its link.
+  void remove(esp8266_transaction *transaction, const uint8_t state);
+
+  // The links_held_ bit for a running transaction's link.
+  uint8_t link_bit(esp8266_transaction *transaction);
+
+  LiteESP8266 *radio_;
+  esp8266_transaction *queue_;
+
+  // Bit n set: link n is held.  With a single link, bit 0 stands for it.
+  uint8_t links_held_;
+  uint8_t links_;
+};
+
+#endif // _LITEESP8266SCHEDULER_H_
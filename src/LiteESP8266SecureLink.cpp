@@ -0,0 +1,148 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266SecureLink.h"
+
+LiteESP8266SecureLink::LiteESP8266SecureLink() {
+  radio_ = NULL;
+  open_ = false;
+  request_started_ = false;
+  idle_ms_ = 0;
+  handshakes_ = 0;
+  last_handshake_ms_ = 0;
+  handshake_ms_ = 0;
+}
+
+void LiteESP8266SecureLink::begin(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const uint8_t link_id, const bool sni) {
+  radio_ = radio;
+  host_ = progmem_host;
+  port_ = port;
+  link_id_ = link_id;
+  sni_ = sni;
+  open_ = false;
+  request_started_ = false;
+  handshakes_ = 0;
+  last_handshake_ms_ = 0;
+  handshake_ms_ = 0;
+}
+
+bool LiteESP8266SecureLink::open() {
+  if (open_) {
+    check_closed();
+  }
+  if (open_ && idle_ms_ && LITE_ESP8266_ELAPSED_MS(last_used_) >= idle_ms_) {
+    // The server has probably given up on it - start again now, rather than
+    // learn that from a failed send.
+    close();
+  }
+  if (!open_) {
+    open_ = connect();
+  }
+  return open_;
+}
+
+bool LiteESP8266SecureLink::connect() {
+  unsigned long start_time;
+
+  if (sni_) {
+    // Without SNI support the handshake goes ahead without it.
+    radio_->set_ssl_sni_progmem(host_, link_id_);
+  }
+  start_time = millis();
+  if (!radio_->connect_progmem(host_, port_, LITE_ESP8266_SSL, link_id_)) {
+    return false;
+  }
+  last_handshake_ms_ = LITE_ESP8266_ELAPSED_MS(start_time);
+  handshake_ms_ += last_handshake_ms_;
+  handshakes_++;
+  last_used_ = millis();
+  return true;
+}
+
+/**
+ * Between requests, nothing should arrive but the radio's "CLOSED" when the
+ * server hangs up.  Anything else is left over, and dropped.
+ */
+void LiteESP8266SecureLink::check_closed() {
+  unsigned int remaining = 0;
+  int c;
+
+  while (open_ && (remaining || radio_->available())) {
+    c = radio_->read_packet_byte(&remaining, COMMAND_RESPONSE_TIMEOUT);
+    if (c == LITE_ESP8266_READ_CLOSED) {
+      open_ = false;
+    } else if (c == LITE_ESP8266_READ_TIMEOUT) {
+      break;
+    }
+  }
+}
+
+void LiteESP8266SecureLink::closed() {
+  open_ = false;
+}
+
+void LiteESP8266SecureLink::close() {
+  if (open_) {
+    radio_->close(link_id_);
+    open_ = false;
+  }
+}
+
+// =============================================================================
+// Sending.
+// =============================================================================
+
+void LiteESP8266SecureLink::begin_request() {
+  request_started_ = false;
+}
+
+bool LiteESP8266SecureLink::send(const char *data) {
+  return start_send(data, false, 0);
+}
+
+bool LiteESP8266SecureLink::send_progmem(const char *progmem_data) {
+  return start_send(progmem_data, true, 0);
+}
+
+bool LiteESP8266SecureLink::begin_send(const unsigned int length) {
+  return start_send(NULL, false, length);
+}
+
+bool LiteESP8266SecureLink::start_send(const char *data, const bool progmem,
+        const unsigned int length) {
+  bool first = !request_started_;
+  bool sent;
+  unsigned int handshakes;
+  uint8_t attempt;
+
+  request_started_ = true;
+  for (attempt = 0; attempt < 2; attempt++) {
+    handshakes = handshakes_;
+    if (first ? !open() : !open_) {
+      return false;
+    }
+
+    if (!data) {
+      sent = radio_->begin_send(length, link_id_);
+    } else if (progmem) {
+      sent = radio_->send_progmem(data, link_id_);
+    } else {
+      sent = radio_->send(data, link_id_);
+    }
+    if (sent) {
+      last_used_ = millis();
+      return true;
+    }
+
+    close();
+    // Past the first send, the server has the start of the request, and the
+    // rest of it on a new link would be nonsense.  And a link that was just
+    // opened isn't going to do any better.
+    if (!first || handshakes_ != handshakes) {
+      return false;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,155 @@
+/**
+ * A long-lived SSL connection, reused across requests.
+ *
+ * Connecting with LITE_ESP8266_SSL costs a TLS handshake - a few round trips
+ * and a second or two of the radio's crypto, with the receiver on the whole
+ * time.  Opening and closing around every request pays that every time, and
+ * for small uploads it's most of the radio-on time.  This keeps one SSL link
+ * open, and sends each request on it (HTTP/1.1, "Connection: keep-alive"),
+ * so the handshake is paid once, and again only if the server closes the
+ * connection.
+ *
+ * LiteESP8266SecureLink link;
+ * // 1.x AT firmware: room for the server's certificate chain, and no SNI.
+ * radio.set_ssl_buffer_size(4096);
+ * link.begin(&radio, host, 443);
+ *
+ * // For each request:
+ * link.begin_request();
+ * if (link.send_progmem(request_headers) && link.send(body)) {
+ *   char *response = radio.get_http_response(64);
+ *   ...
+ * }
+ *
+ * Before each request, open() looks for the radio's "CLOSED" from a server
+ * that has hung up, and reconnects if there is one.  If the server closed
+ * without the radio noticing, the first send of the request fails, and is
+ * tried once more on a new connection.  Only the first: if a later send
+ * fails, the server already has part of the request, so the link is closed
+ * and the send returns false - start the request again.  Call begin_request()
+ * before each request so the link knows where one starts, and do all of its
+ * sending through the link.
+ * Servers drop idle keep-alive connections, usually after 5 to 60 seconds;
+ * set_idle_timeout() reconnects up front after that long, rather than finding
+ * out from a failed send.  Call closed() if the server says it's closing
+ * ("Connection: close").
+ *
+ * The handshakes are counted and timed, from the connect command to the
+ * radio's OK.  Active receive mode only.  The object uses 28 bytes of SRAM.
+ */
+
+#ifndef _LITEESP8266SECURELINK_H_
+#define _LITEESP8266SECURELINK_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+class LiteESP8266SecureLink {
+public:
+  LiteESP8266SecureLink();
+
+  /**
+   * Set up the link.  It connects when first used.
+   *
+   * @param radio The radio.
+   * @param progmem_host The server (IP or DNS name), in program memory.
+   * @param port The server port.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @param sni True to send the host name with SNI on each handshake.  ESP-AT
+   *   2.x firmware only (see LiteESP8266::set_ssl_sni_progmem()) - leave it
+   *   false on 1.x.
+   */
+  void begin(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port = 443,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK,
+          const bool sni = false);
+
+  /**
+   * Make sure the link is open: if the server has closed it, or it has been
+   * idle past the idle timeout, connect again.
+   *
+   * @return True if the link is open.
+   */
+  bool open();
+
+  /**
+   * Start a request: the next send is its first.
+   */
+  void begin_request();
+
+  /**
+   * Send on the link.  The first send of a request opens the link first if
+   * needed, and if it fails on a link that was already open, it's taken as
+   * closed, and the send is tried once more on a new one.  A later send that
+   * fails closes the link.
+   *
+   * @param data The data, in data memory or program memory.
+   * @return True if the data was sent.
+   */
+  bool send(const char *data);
+  bool send_progmem(const char *progmem_data);
+
+  /**
+   * Start a send of length bytes on the link, opening it and retrying as
+   * send() does.  Write the data to the radio, and finish with the
+   * radio's end_send().
+   *
+   * @param length The number of bytes to follow.
+   * @return True if the radio is ready for the data.
+   */
+  bool begin_send(const unsigned int length);
+
+  // The server is closing the link - the next request opens a new one.
+  void closed();
+
+  // Close the link.
+  void close();
+
+  /**
+   * Reconnect before a request if the link has been idle this long - just
+   * under the server's keep-alive timeout.  0, the default, never does.
+   */
+  void set_idle_timeout(const unsigned long idle_ms) { idle_ms_ = idle_ms; }
+
+  bool is_open() { return open_; }
+
+  // Handshakes so far, and how long they took: the last one, and in total.
+  unsigned int handshakes() { return handshakes_; }
+  unsigned long last_handshake_ms() { return last_handshake_ms_; }
+  unsigned long handshake_ms() { return handshake_ms_; }
+
+private:
+  // Connect, timing the handshake.
+  bool connect();
+
+  // Read anything the radio has said since the last request, looking for
+  // the link closing.
+  void check_closed();
+
+  /**
+   * The send and retry behind send(), send_progmem() and begin_send().
+   *
+   * @param data The data, or NULL to begin a send of length bytes.
+   */
+  bool start_send(const char *data, const bool progmem,
+          const unsigned int length);
+
+  LiteESP8266 *radio_;
+  const char *host_;
+  unsigned int port_;
+  uint8_t link_id_;
+  bool sni_;
+  bool open_;
+  bool request_started_;
+
+  unsigned long idle_ms_;
+  unsigned long last_used_;
+
+  unsigned int handshakes_;
+  unsigned long last_handshake_ms_;
+  unsigned long handshake_ms_;
+};
+
+#endif // _LITEESP8266SECURELINK_H_
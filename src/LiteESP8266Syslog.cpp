@@ -0,0 +1,183 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266Syslog.h"
+
+// Datagram pieces: "<134>tag: " and the note of lost lines.
+const char SYSLOG_TAG_END[] PROGMEM = ": ";
+const char SYSLOG_DROPPED_START[] PROGMEM = "(";
+const char SYSLOG_DROPPED_END[] PROGMEM = " lines dropped)";
+
+LiteESP8266SyslogSink::LiteESP8266SyslogSink() {
+  radio_ = NULL;
+  buffer_ = NULL;
+  buffer_size_ = 0;
+  length_ = 0;
+  line_end_ = 0;
+  lines_ = 0;
+  dropped_ = 0;
+  unreported_ = 0;
+  connected_ = false;
+  dropping_ = false;
+  full_ = false;
+}
+
+void LiteESP8266SyslogSink::begin(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const char *progmem_tag, char *buffer, const unsigned int buffer_size,
+        const uint8_t link_id, const unsigned int flush_ms) {
+  radio_ = radio;
+  host_ = progmem_host;
+  port_ = port;
+  tag_ = progmem_tag;
+  buffer_ = buffer;
+  buffer_size_ = buffer_size;
+  link_id_ = link_id;
+  flush_ms_ = flush_ms;
+  length_ = 0;
+  line_end_ = 0;
+  lines_ = 0;
+  dropped_ = 0;
+  unreported_ = 0;
+  connected_ = false;
+  dropping_ = false;
+  full_ = false;
+}
+
+// =============================================================================
+// Collecting lines.  Nothing here waits on the radio.
+// =============================================================================
+
+size_t LiteESP8266SyslogSink::write(uint8_t c) {
+  if (!buffer_ || c == '\r') {
+    // println()'s "\r\n" is kept as just the '\n'.
+    return 1;
+  }
+  if (dropping_) {
+    dropping_ = (c != '\n');
+    return 1;
+  }
+  if (length_ == buffer_size_) {
+    // No room: lose the whole line, not just its end.
+    length_ = line_end_;
+    dropped_++;
+    unreported_++;
+    full_ = true;
+    dropping_ = (c != '\n');
+    return 1;
+  }
+
+  buffer_[length_++] = c;
+  if (c == '\n') {
+    if (!lines_) {
+      oldest_at_ = millis();
+    }
+    line_end_ = length_;
+    lines_++;
+  }
+  return 1;
+}
+
+// =============================================================================
+// Sending.
+// =============================================================================
+
+bool LiteESP8266SyslogSink::poll() {
+  if (!radio_ || (!lines_ && !unreported_)) {
+    return true;
+  }
+  if (full_ || line_end_ >= buffer_size_ - buffer_size_ / 4 ||
+          LITE_ESP8266_ELAPSED_MS(oldest_at_) >= flush_ms_) {
+    return send_now();
+  }
+  return true;
+}
+
+bool LiteESP8266SyslogSink::send_now() {
+  bool sent;
+
+  if (!radio_ || (!lines_ && !unreported_)) {
+    return true;
+  }
+  sent = send_batch();
+  if (!sent) {
+    // Try again later, with a fresh link.
+    if (connected_) {
+      radio_->close(link_id_);
+      connected_ = false;
+    }
+    oldest_at_ = millis();
+    dropped_ += lines_;
+    unreported_ += lines_;
+  } else {
+    unreported_ = 0;
+  }
+  discard_batch();
+  return sent;
+}
+
+/**
+ * Looks like:
+ * <134>ferret-07: door opened
+ * relay 2 on
+ * (3 lines dropped)
+ *
+ * The last line's '\n' isn't sent.
+ */
+bool LiteESP8266SyslogSink::send_batch() {
+  // "<255>" and the null.
+  char priority[6];
+  // "65535" and the null.
+  char count[6];
+  unsigned int length, i;
+  unsigned int text_length = line_end_ ? line_end_ - 1 : 0;
+
+  priority[0] = '<';
+  itoa(SYSLOG_PRIORITY, priority + 1, 10);
+  strcat(priority, ">");
+  length = strlen(priority) + strlen_P(tag_) + strlen_P(SYSLOG_TAG_END) +
+      text_length;
+  if (unreported_) {
+    utoa(unreported_, count, 10);
+    length += (lines_ ? 1 : 0) + strlen_P(SYSLOG_DROPPED_START) +
+        LiteESP8266::digit_count(unreported_) + strlen_P(SYSLOG_DROPPED_END);
+  }
+  if (length > LITE_ESP8266_MAX_SEND_LENGTH) {
+    return false;
+  }
+
+  if (!connected_) {
+    connected_ = radio_->connect_progmem(host_, port_, LITE_ESP8266_UDP,
+            link_id_);
+    if (!connected_) {
+      return false;
+    }
+  }
+  if (!radio_->begin_send(length, link_id_)) {
+    return false;
+  }
+  radio_->write_string(priority);
+  radio_->write_progmem(tag_);
+  radio_->write_progmem(SYSLOG_TAG_END);
+  for (i = 0; i < text_length; i++) {
+    radio_->write(buffer_[i]);
+  }
+  if (unreported_) {
+    if (lines_) {
+      radio_->write('\n');
+    }
+    radio_->write_progmem(SYSLOG_DROPPED_START);
+    radio_->write_string(count);
+    radio_->write_progmem(SYSLOG_DROPPED_END);
+  }
+  return radio_->end_send();
+}
+
+void LiteESP8266SyslogSink::discard_batch() {
+  // Keep any line still being written.
+  memmove(buffer_, buffer_ + line_end_, length_ - line_end_);
+  length_ -= line_end_;
+  line_end_ = 0;
+  lines_ = 0;
+  full_ = false;
+}
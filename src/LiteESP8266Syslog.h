@@ -0,0 +1,151 @@
+/**
+ * Batched log shipping to a syslog server over UDP.
+ *
+ * Getting serial logs off a device in the field by HTTP costs a connection, a
+ * request and a response per line.  This is a Print, so anything that logs to
+ * a Print - LiteSerialLogger, or print() and println() - can log to it.  Lines
+ * collect in a small buffer, and go out as one syslog datagram when the
+ * buffer is filling up or the oldest line has waited long enough:
+ *
+ * <134>ferret-07: door opened
+ * relay 2 on
+ * battery 3712mV
+ *
+ * That's one message, facility local0, severity info (see SYSLOG_PRIORITY),
+ * with the lines inside it - the collector stamps the time it arrives.
+ *
+ * One message per batch is a deliberate trade-off.  Collectors keep the later
+ * lines inside the first one's message, usually showing the line breaks as
+ * "#012", and only the first line has the priority and tag to filter on.  In
+ * return a batch costs one AT command round, where a message per line would
+ * cost a round per line, with the radio's receiver on throughout.  If each
+ * line has to stand on its own in the collector, call send_now() after each
+ * one.
+ *
+ * char log_buffer[192];
+ * LiteESP8266SyslogSink syslog;
+ * radio.set_multiple_connections(true);
+ * syslog.begin(&radio, log_host, 514, node_name, log_buffer,
+ *         sizeof(log_buffer), 4);
+ *
+ * void loop() {
+ *   syslog.println(F("door opened"));
+ *   // Everything else.
+ *   syslog.poll();
+ * }
+ *
+ * Logging never touches the radio: print() only copies into the buffer, and
+ * if the line doesn't fit, the whole line is dropped and counted rather than
+ * waiting for room.  The next datagram ends with a note of how many lines were
+ * lost.  Only poll() (or send_now()) sends - one AT command round, when the
+ * sketch chooses.
+ *
+ * The UDP link is opened on the first send and kept.  With multiple
+ * connections, give it a link of its own; with one connection it holds it, so
+ * the rest of the sketch can't connect.  A batch that fails to send is
+ * dropped and counted too, and the link is opened again next time.  Keep the
+ * buffer under about 2000 bytes, the most one send takes.  Don't log the sink's
+ * own radio traffic to it.
+ *
+ * The sink uses 38 bytes of SRAM, Print's 4 included, plus the buffer.
+ */
+
+#ifndef _LITEESP8266SYSLOG_H_
+#define _LITEESP8266SYSLOG_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+// Facility local0 (16) times 8, plus severity info (6).
+#ifndef SYSLOG_PRIORITY
+#define SYSLOG_PRIORITY 134
+#endif
+
+// How long the oldest line waits before poll() sends.
+#define SYSLOG_DEFAULT_FLUSH_MS 5000
+
+class LiteESP8266SyslogSink : public Print {
+public:
+  LiteESP8266SyslogSink();
+
+  /**
+   * Set up the sink.  Nothing is sent until there's something to send.
+   *
+   * @param radio The radio.
+   * @param progmem_host The syslog server (IP or DNS name), in program memory.
+   * @param port The server port - 514 is syslog's.
+   * @param progmem_tag The name the lines go under - the node, or the
+   *   program - in program memory.
+   * @param buffer Where lines collect.
+   * @param buffer_size The size of buffer.  A line longer than this is always
+   *   dropped.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @param flush_ms How long a line can wait before poll() sends it.
+   */
+  void begin(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port, const char *progmem_tag, char *buffer,
+          const unsigned int buffer_size,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK,
+          const unsigned int flush_ms = SYSLOG_DEFAULT_FLUSH_MS);
+
+  // Print's output: collect a byte.  Never blocks, and never fails.
+  size_t write(uint8_t c);
+  using Print::write;
+
+  /**
+   * Send the complete lines if the buffer is three quarters full, a line has
+   * been dropped for lack of room, or the oldest has waited flush_ms.  Call it
+   * from loop().
+   *
+   * @return True unless a send was needed and failed.
+   */
+  bool poll();
+
+  /**
+   * Send the complete lines now.  A line still being written stays for the
+   * next send.  (Not Print's flush(), which can't say how it went.)
+   *
+   * @return True if they were sent, or there was nothing to send.
+   */
+  bool send_now();
+
+  // Lines lost - for lack of room, or in a failed send - since begin().
+  unsigned long dropped_lines() { return dropped_; }
+
+private:
+  // Send the datagram.  Returns true if the radio took it.
+  bool send_batch();
+
+  // The complete lines are done with - sent or dropped.
+  void discard_batch();
+
+  LiteESP8266 *radio_;
+  const char *host_;
+  const char *tag_;
+  unsigned int port_;
+  uint8_t link_id_;
+  unsigned int flush_ms_;
+
+  char *buffer_;
+  unsigned int buffer_size_;
+  unsigned int length_;
+
+  // The end of the last complete line, and how many there are.
+  unsigned int line_end_;
+  unsigned int lines_;
+  unsigned long oldest_at_;
+
+  unsigned long dropped_;
+  // Lost since the last datagram, for its note.
+  unsigned int unreported_;
+
+  bool connected_;
+  // Skipping the rest of a line that didn't fit.
+  bool dropping_;
+  // A line didn't fit - time to send.
+  bool full_;
+};
+
+#endif // _LITEESP8266SYSLOG_H_
@@ -0,0 +1,296 @@
+
+#include <Arduino.h>
+
+#include "LiteESP8266Upload.h"
+
+// Request pieces.
+const char UPLOAD_POST[] PROGMEM = "POST ";
+const char UPLOAD_HEAD[] PROGMEM = "HEAD ";
+const char UPLOAD_HOST[] PROGMEM = " HTTP/1.1\r\nHost: ";
+const char UPLOAD_CONTENT_LENGTH[] PROGMEM = "\r\nContent-Length: ";
+const char UPLOAD_OFFSET[] PROGMEM = "\r\nX-Upload-Offset: ";
+const char UPLOAD_LENGTH[] PROGMEM = "\r\nX-Upload-Length: ";
+const char UPLOAD_CLOSE[] PROGMEM = "\r\nConnection: close\r\n\r\n";
+
+// Response pieces.
+const char UPLOAD_HTTP[] PROGMEM = "HTTP/";
+const char UPLOAD_OFFSET_HEADER[] PROGMEM = "x-upload-offset:";
+
+#define HTTP_OK_FIRST 200
+#define HTTP_OK_LAST 299
+
+// Response parser states.  Each line is matched as it arrives, unbuffered.
+#define UPLOAD_STATE_NAME 0
+#define UPLOAD_STATE_STATUS 1
+#define UPLOAD_STATE_OFFSET 2
+#define UPLOAD_STATE_IGNORE 3
+
+
+LiteESP8266Upload::LiteESP8266Upload() {
+  radio_ = NULL;
+  acknowledged_ = 0;
+  status_ = 0;
+  segment_left_ = 0;
+  link_id_ = LITE_ESP8266_NO_LINK;
+  padded_ = false;
+}
+
+uint8_t LiteESP8266Upload::upload(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const char *progmem_path, Stream *source, const unsigned long length,
+        const unsigned long offset, const unsigned int segment_size,
+        const uint8_t link_id) {
+  unsigned long body_length = length - offset;
+  unsigned long request_length, sent = 0;
+  unsigned int header_length, segment;
+  bool source_dry = false;
+  int available, c;
+
+  radio_ = radio;
+  link_id_ = link_id;
+  acknowledged_ = offset;
+  padded_ = false;
+  status_ = 0;
+
+  if (offset > length || segment_size > LITE_ESP8266_MAX_SEND_LENGTH) {
+    return LITE_ESP8266_FAILURE;
+  }
+
+  header_length = strlen_P(UPLOAD_POST) + strlen_P(progmem_path) +
+      strlen_P(UPLOAD_HOST) + strlen_P(progmem_host) +
+      strlen_P(UPLOAD_CONTENT_LENGTH) +
+      LiteESP8266::digit_count(body_length) +
+      strlen_P(UPLOAD_OFFSET) + LiteESP8266::digit_count(offset) +
+      strlen_P(UPLOAD_LENGTH) + LiteESP8266::digit_count(length) +
+      strlen_P(UPLOAD_CLOSE);
+  if (header_length > segment_size) {
+    return LITE_ESP8266_LENGTH_EXCEEDED;
+  }
+  request_length = header_length + body_length;
+
+  if (!radio_->connect_progmem(progmem_host, port, LITE_ESP8266_TCP,
+          link_id_)) {
+    return LITE_ESP8266_FAILURE;
+  }
+
+  // The request is one stream of bytes - headers, then the file - cut into
+  // sends as big as allowed.
+  while (sent < request_length) {
+    segment = (request_length - sent > segment_size) ? segment_size :
+        (unsigned int)(request_length - sent);
+
+    // Once a send starts, the radio takes all of it, and anything made up to
+    // fill it would end up in the server's copy of the file - and in its
+    // count of what it has.  So the file has to have the whole segment first.
+    available = source->available();
+    if (available < 0 ||
+            (unsigned int)available < segment - (sent ? 0 : header_length)) {
+      radio_->close(link_id_);
+      return LITE_ESP8266_FAILURE;
+    }
+    if (!radio_->begin_send(segment, link_id_)) {
+      radio_->close(link_id_);
+      return LITE_ESP8266_FAILURE;
+    }
+    segment_left_ = segment;
+
+    if (sent == 0) {
+      put_headers(progmem_host, progmem_path, length, offset);
+    }
+    while (segment_left_) {
+      if (!source_dry && (c = source->read()) < 0) {
+        // The source said it had this.  The radio wants the rest of the send
+        // regardless, and can't be stopped from passing it on, so it's made
+        // up with nulls - and the file ends where they start.
+        source_dry = true;
+        padded_ = true;
+        acknowledged_ = offset +
+            (sent + segment - segment_left_ - header_length);
+      }
+      put(source_dry ? 0 : (char)c);
+    }
+
+    if (!radio_->end_send() || source_dry) {
+      // The server keeps at least what was acknowledged before this send.
+      radio_->close(link_id_);
+      return LITE_ESP8266_FAILURE;
+    }
+    sent += segment;
+    if (sent > header_length) {
+      acknowledged_ = offset + (sent - header_length);
+    }
+  }
+
+  read_response();
+  radio_->close(link_id_);
+
+  if (status_ >= HTTP_OK_FIRST && status_ <= HTTP_OK_LAST) {
+    acknowledged_ = length;
+    return LITE_ESP8266_SUCCESS;
+  }
+  return LITE_ESP8266_FAILURE;
+}
+
+uint8_t LiteESP8266Upload::query_offset(LiteESP8266 *radio,
+        const char *progmem_host, const unsigned int port,
+        const char *progmem_path, const uint8_t link_id) {
+  unsigned long acknowledged = acknowledged_;
+  unsigned int length = strlen_P(UPLOAD_HEAD) + strlen_P(progmem_path) +
+      strlen_P(UPLOAD_HOST) + strlen_P(progmem_host) + strlen_P(UPLOAD_CLOSE);
+  bool found;
+
+  radio_ = radio;
+  link_id_ = link_id;
+  status_ = 0;
+
+  if (!radio_->connect_progmem(progmem_host, port, LITE_ESP8266_TCP,
+          link_id_)) {
+    return LITE_ESP8266_FAILURE;
+  }
+  if (!radio_->begin_send(length, link_id_)) {
+    radio_->close(link_id_);
+    return LITE_ESP8266_FAILURE;
+  }
+  segment_left_ = length;
+  put_progmem(UPLOAD_HEAD);
+  put_progmem(progmem_path);
+  put_progmem(UPLOAD_HOST);
+  put_progmem(progmem_host);
+  put_progmem(UPLOAD_CLOSE);
+  found = radio_->end_send() && read_response();
+  radio_->close(link_id_);
+
+  if (found && status_ >= HTTP_OK_FIRST && status_ <= HTTP_OK_LAST) {
+    // The server counts any nulls the last upload was padded with.
+    if (padded_ && acknowledged_ > acknowledged) {
+      acknowledged_ = acknowledged;
+    }
+    return LITE_ESP8266_SUCCESS;
+  }
+  acknowledged_ = acknowledged;
+  return LITE_ESP8266_FAILURE;
+}
+
+void LiteESP8266Upload::put_headers(const char *progmem_host,
+        const char *progmem_path, const unsigned long length,
+        const unsigned long offset) {
+  put_progmem(UPLOAD_POST);
+  put_progmem(progmem_path);
+  put_progmem(UPLOAD_HOST);
+  put_progmem(progmem_host);
+  put_progmem(UPLOAD_CONTENT_LENGTH);
+  put_number(length - offset);
+  put_progmem(UPLOAD_OFFSET);
+  put_number(offset);
+  put_progmem(UPLOAD_LENGTH);
+  put_number(length);
+  put_progmem(UPLOAD_CLOSE);
+}
+
+/**
+ * Looks like:
+ * HTTP/1.1 200 OK
+ * or, to a HEAD, or if the server is missing some of what was sent:
+ * HTTP/1.1 409 Conflict
+ * Date: Sat, 24 Dec 2016 20:33:00 GMT
+ * Server: Apache/2.4.10 (Raspbian)
+ * X-Upload-Offset: 20480
+ *
+ * Read a byte at a time up to the blank line, so the header can be anywhere
+ * among them.  The header name is case insensitive.
+ */
+bool LiteESP8266Upload::read_response() {
+  unsigned int remaining = 0;
+  unsigned long offset = 0;
+  uint8_t state = UPLOAD_STATE_NAME;
+  uint8_t matched = 0;
+  bool status_line = true;
+  bool blank_line = true;
+  bool found = false;
+  char expected;
+  int c;
+
+  while ((c = radio_->read_packet_byte(&remaining, CLIENT_CONNECT_TIMEOUT)) >=
+          0) {
+    if (c == '\r') {
+      continue;
+    }
+    if (c == '\n') {
+      if (blank_line) {
+        // The end of the headers.
+        break;
+      }
+      status_line = false;
+      blank_line = true;
+      state = UPLOAD_STATE_NAME;
+      matched = 0;
+      continue;
+    }
+    blank_line = false;
+
+    switch (state) {
+      case UPLOAD_STATE_NAME:
+        // "HTTP/1.1 " on the first line, or the header's name on the others.
+        expected = pgm_read_byte((status_line ? UPLOAD_HTTP :
+                UPLOAD_OFFSET_HEADER) + matched);
+        if (status_line && !expected) {
+          // Past "HTTP/": the version, up to the space.
+          if (c == ' ') {
+            state = UPLOAD_STATE_STATUS;
+          }
+        } else if ((status_line ? c : tolower(c)) == expected) {
+          matched++;
+          if (!status_line &&
+                  !pgm_read_byte(UPLOAD_OFFSET_HEADER + matched)) {
+            found = true;
+            offset = 0;
+            state = UPLOAD_STATE_OFFSET;
+          }
+        } else {
+          state = UPLOAD_STATE_IGNORE;
+        }
+        break;
+      case UPLOAD_STATE_STATUS:
+        if (c >= '0' && c <= '9') {
+          status_ = status_ * 10 + (c - '0');
+        } else {
+          state = UPLOAD_STATE_IGNORE;
+        }
+        break;
+      case UPLOAD_STATE_OFFSET:
+        if (c >= '0' && c <= '9') {
+          offset = offset * 10 + (c - '0');
+        } else if (c != ' ' || offset) {
+          state = UPLOAD_STATE_IGNORE;
+        }
+        break;
+    }
+  }
+
+  if (found) {
+    acknowledged_ = offset;
+  }
+  return found;
+}
+
+// =============================================================================
+// Output to the current send.
+// =============================================================================
+
+void LiteESP8266Upload::put(const char c) {
+  radio_->write(c);
+  segment_left_--;
+}
+
+void LiteESP8266Upload::put_progmem(const char *progmem_string) {
+  radio_->write_progmem(progmem_string);
+  segment_left_ -= strlen_P(progmem_string);
+}
+
+void LiteESP8266Upload::put_number(const unsigned long value) {
+  // "4294967295" and the null.
+  char digits[11];
+
+  radio_->write_string(ultoa(value, digits, 10));
+  segment_left_ -= LiteESP8266::digit_count(value);
+}
@@ -0,0 +1,152 @@
+/**
+ * Resumable uploads streamed from a file.
+ *
+ * Uploading a log from an SD card usually means reading a chunk into a
+ * buffer, sending it, and repeating - a send command for every chunk, and the
+ * buffer in SRAM.  This sends the whole file as one POST instead, copied from
+ * the source straight to the radio in sends of up to 2048 bytes (the most the
+ * radio takes at once), with no buffer in between.
+ *
+ * Every request says where in the file its body starts:
+ *
+ * POST /upload HTTP/1.1
+ * Host: example.com
+ * Content-Length: 40960
+ * X-Upload-Offset: 24576
+ * X-Upload-Length: 65536
+ * Connection: close
+ *
+ * so when the connection drops partway, the upload can carry on from where
+ * it got to rather than start over.  The radio acknowledging a send only means
+ * the data went into its TCP buffers - some of it may not have made it - so
+ * before resuming, ask the server what it has:
+ *
+ * LiteESP8266Upload upload;
+ * unsigned long offset = 0;
+ * for (uint8_t attempt = 0; attempt < 3; attempt++) {
+ *   file.seek(offset);
+ *   if (upload.upload(&radio, host, 80, path, &file, file.size(), offset) ==
+ *           LITE_ESP8266_SUCCESS) {
+ *     break;
+ *   }
+ *   // If the server can't be asked, this falls back on what the radio took.
+ *   upload.query_offset(&radio, host, 80, path);
+ *   offset = upload.acknowledged_offset();
+ * }
+ *
+ * The server's side of the bargain: answer a HEAD with the bytes it holds, in
+ * an X-Upload-Offset header; and for a POST, keep the first X-Upload-Offset
+ * bytes it has, drop anything past them, and append the body.  If it has fewer
+ * bytes than the offset, it answers "409 Conflict", with its own count in an
+ * X-Upload-Offset header, and the next attempt starts there.  Any 2xx to a
+ * POST means the file is complete.  An upload that gives up partway can leave
+ * nulls at the end of the server's copy (see upload()), so the server must
+ * check what it has - the X-Upload-Length, a checksum - before using it.
+ *
+ * The object uses 12 bytes of SRAM.  The response is read a byte at a time,
+ * with no buffer.
+ */
+
+#ifndef _LITEESP8266UPLOAD_H_
+#define _LITEESP8266UPLOAD_H_
+
+#include <Arduino.h>
+
+#include "LiteESP8266Client.h"
+
+class LiteESP8266Upload {
+public:
+  LiteESP8266Upload();
+
+  /**
+   * Upload the rest of a file, from offset on, in one POST.
+   *
+   * The source must be positioned at offset, and its available() must count
+   * the bytes it has left - a file, not a network stream.  Before each send,
+   * the source has to have all of that send's bytes: if it doesn't, the
+   * connection is closed and the upload fails, with the server keeping only
+   * what was sent before.
+   *
+   * If a read from the source fails partway through a send anyway, the send
+   * can't be cut short: the rest of it goes out as nulls, and the upload
+   * fails.  acknowledged_offset() stops where the nulls start, and neither it
+   * nor query_offset() goes past that, so the next attempt has the server drop
+   * them.  Until then, the server's copy has them.
+   *
+   * @param radio The radio.
+   * @param progmem_host The server (IP or DNS name), in program memory.
+   * @param port The server port.
+   * @param progmem_path The path to POST to, in program memory.
+   * @param source The file, at offset.
+   * @param length The length of the whole file.
+   * @param offset Where to start - 0, or acknowledged_offset() from a failed
+   *   attempt.
+   * @param segment_size Bytes per send, up to LITE_ESP8266_MAX_SEND_LENGTH.
+   *   The request headers go in the first send, so they must fit.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @return LITE_ESP8266_SUCCESS once the server answers with a 2xx,
+   *   LITE_ESP8266_LENGTH_EXCEEDED if the headers don't fit a send, or
+   *   LITE_ESP8266_FAILURE - try again from acknowledged_offset().
+   */
+  uint8_t upload(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port, const char *progmem_path, Stream *source,
+          const unsigned long length, const unsigned long offset = 0,
+          const unsigned int segment_size = LITE_ESP8266_MAX_SEND_LENGTH,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  /**
+   * Ask the server how much of the file it has, with a HEAD request, and set
+   * acknowledged_offset() to that - or to where the file stopped, if the last
+   * upload had to pad a send with nulls.
+   *
+   * @param radio The radio.
+   * @param progmem_host The server (IP or DNS name), in program memory.
+   * @param port The server port.
+   * @param progmem_path The upload path, in program memory.
+   * @param link_id The link to use with multiple connections enabled,
+   *   otherwise LITE_ESP8266_NO_LINK.
+   * @return LITE_ESP8266_SUCCESS if the server gave its offset, otherwise
+   *   LITE_ESP8266_FAILURE, with acknowledged_offset() unchanged.
+   */
+  uint8_t query_offset(LiteESP8266 *radio, const char *progmem_host,
+          const unsigned int port, const char *progmem_path,
+          const uint8_t link_id = LITE_ESP8266_NO_LINK);
+
+  // How much of the file the server is known to have - where to resume.
+  unsigned long acknowledged_offset() { return acknowledged_; }
+
+  // The HTTP status of the last response, or 0 if there wasn't one.
+  unsigned int status() { return status_; }
+
+private:
+  // Write the request headers.
+  void put_headers(const char *progmem_host, const char *progmem_path,
+          const unsigned long length, const unsigned long offset);
+
+  /**
+   * Read the server's answer into status_, and any X-Upload-Offset into
+   * acknowledged_.
+   *
+   * @return True if there was an X-Upload-Offset.
+   */
+  bool read_response();
+
+  void put(const char c);
+  void put_progmem(const char *progmem_string);
+  void put_number(const unsigned long value);
+
+  LiteESP8266 *radio_;
+  unsigned long acknowledged_;
+  unsigned int status_;
+
+  // Bytes left in the current send.
+  unsigned int segment_left_;
+  uint8_t link_id_;
+
+  // The last upload padded a send with nulls: acknowledged_ is where the file
+  // stopped, and the server's count is past it.
+  bool padded_;
+};
+
+#endif // _LITEESP8266UPLOAD_H_